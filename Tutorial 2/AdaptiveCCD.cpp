@@ -0,0 +1,113 @@
+#include "AdaptiveCCD.h"
+
+namespace PhysicsEngine
+{
+	void AdaptiveCCD::Add(PxRigidDynamic* body)
+	{
+		if (indices.find(body) != indices.end())
+			return;
+
+		PxReal extent = MinExtent(body);
+		if (extent <= 0.f)
+			return;
+
+		//a recycled body may still have CCD on
+		Body entry = { body, extent, (body->getRigidBodyFlags() & PxRigidBodyFlag::eENABLE_CCD) ? true : false };
+		if (entry.enabled)
+			enabled_count++;
+		indices[body] = (PxU32)bodies.size();
+		bodies.push_back(entry);
+	}
+
+	void AdaptiveCCD::Remove(const PxActor* body)
+	{
+		std::unordered_map<const PxActor*, PxU32>::iterator it = indices.find(body);
+		if (it == indices.end())
+			return;
+
+		//move the last body into the gap
+		PxU32 index = it->second;
+		indices.erase(it);
+		if (bodies[index].enabled)
+			enabled_count--;
+		if (index != bodies.size() - 1)
+		{
+			bodies[index] = bodies.back();
+			indices[bodies[index].body] = index;
+		}
+		bodies.pop_back();
+	}
+
+	void AdaptiveCCD::Clear()
+	{
+		bodies.clear();
+		indices.clear();
+		enabled_count = 0;
+	}
+
+	void AdaptiveCCD::Update(PxReal dt)
+	{
+		for (PxU32 i = 0; i < bodies.size(); i++)
+		{
+			Body& entry = bodies[i];
+
+			//sleeping bodies do not move, keep their flag as it is
+			if (entry.body->isSleeping())
+				continue;
+
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			bool kinematic = (entry.body->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC) ? true : false;
+#else
+			bool kinematic = (entry.body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC) ? true : false;
+#endif
+			//compare squared distances, no square root per body
+			PxReal distance = entry.body->getLinearVelocity().magnitudeSquared() * dt * dt;
+			bool enable = !kinematic && (distance > entry.extent * entry.extent);
+
+			//flags are only written on a change
+			if (enable != entry.enabled)
+			{
+				entry.body->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_CCD, enable);
+				entry.enabled = enable;
+				if (enable)
+					enabled_count++;
+				else
+					enabled_count--;
+			}
+		}
+	}
+
+	PxReal AdaptiveCCD::MinExtent(PxRigidActor* actor)
+	{
+		std::vector<PxShape*> shapes(actor->getNbShapes());
+		if (shapes.empty())
+			return 0.f;
+		actor->getShapes(shapes.data(), (PxU32)shapes.size());
+
+		PxReal extent = PX_MAX_F32;
+		for (PxU32 i = 0; i < shapes.size(); i++)
+		{
+			if (!(shapes[i]->getFlags() & PxShapeFlag::eSIMULATION_SHAPE))
+				continue;
+
+			PxGeometryHolder holder = shapes[i]->getGeometry();
+			switch (holder.getType())
+			{
+			case PxGeometryType::eSPHERE:
+				extent = PxMin(extent, holder.sphere().radius);
+				break;
+			case PxGeometryType::eCAPSULE:
+				extent = PxMin(extent, holder.capsule().radius);
+				break;
+			case PxGeometryType::eBOX:
+				extent = PxMin(extent, holder.box().halfExtents.minElement());
+				break;
+			default:
+				//meshes: the world bounds at the current pose
+				extent = PxMin(extent, PxShapeExt::getWorldBounds(*shapes[i], *actor).getExtents().minElement());
+				break;
+			}
+		}
+		return (extent < PX_MAX_F32) ? extent : 0.f;
+	}
+}
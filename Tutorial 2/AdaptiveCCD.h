@@ -0,0 +1,66 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <unordered_map>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Continuous collision detection of the dynamic actors in a scene
+	struct CCDMode
+	{
+		enum Enum
+		{
+			OFF,
+			//only bodies moving further than their smallest extent in a step (see AdaptiveCCD)
+			ADAPTIVE,
+			//every dynamic body
+			ALWAYS
+		};
+	};
+
+	///Turns eENABLE_CCD on for the bodies that would move further than their smallest shape extent
+	///in the coming step and off again once they slow down, so only fast bodies pay for swept contacts.
+	///Only the linear velocity is considered, trigger shapes never use CCD.
+	class AdaptiveCCD
+	{
+		struct Body
+		{
+			PxRigidDynamic* body;
+			//smallest half extent of the simulation shapes
+			PxReal extent;
+			bool enabled;
+		};
+
+		std::vector<Body> bodies;
+		//index of each body in bodies
+		std::unordered_map<const PxActor*, PxU32> indices;
+		PxU32 enabled_count;
+
+	public:
+		AdaptiveCCD() : enabled_count(0) {}
+
+		///Add a body, nothing happens if it has no simulation shapes or was already added
+		void Add(PxRigidDynamic* body);
+
+		///Remove a body, nothing happens if it was not added
+		void Remove(const PxActor* body);
+
+		///Remove all bodies
+		void Clear();
+
+		///Number of bodies
+		PxU32 Size() const { return (PxU32)bodies.size(); }
+
+		///Number of bodies with CCD turned on
+		PxU32 Enabled() const { return enabled_count; }
+
+		///Switch CCD on the bodies for a step of length dt, call it before every simulate
+		void Update(PxReal dt);
+
+		///Smallest half extent of the simulation shapes of an actor, 0 if it has none
+		static PxReal MinExtent(PxRigidActor* actor);
+	};
+}
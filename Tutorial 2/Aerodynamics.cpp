@@ -0,0 +1,147 @@
+#include "Aerodynamics.h"
+#include <xmmintrin.h>
+
+namespace PhysicsEngine
+{
+	void Aerodynamics::Batch::Resize(PxU32 new_size)
+	{
+		size = new_size;
+		PxU32 padded = (new_size + 3) & ~3u;
+
+		std::vector<PxReal>* streams[] = { &vx, &vy, &vz, &wx, &wy, &wz, &ax, &ay, &az,
+			&axial_area, &side_area, &magnus_arm, &tumble_arm, &fx, &fy, &fz, &tx, &ty, &tz };
+		for (PxU32 i = 0; i < sizeof(streams) / sizeof(streams[0]); i++)
+		{
+			streams[i]->resize(padded);
+			//padding lanes produce zero forces
+			for (PxU32 j = new_size; j < padded; j++)
+				(*streams[i])[j] = 0.f;
+		}
+	}
+
+	void Aerodynamics::Add(PxRigidDynamic* body, PxReal radius, PxReal half_length)
+	{
+		if (indices.find(body) != indices.end())
+			return;
+
+		Body entry = { body, radius, half_length };
+		indices[body] = (PxU32)bodies.size();
+		bodies.push_back(entry);
+	}
+
+	void Aerodynamics::Remove(const PxActor* body)
+	{
+		std::unordered_map<const PxActor*, PxU32>::iterator it = indices.find(body);
+		if (it == indices.end())
+			return;
+
+		//move the last body into the gap
+		PxU32 index = it->second;
+		indices.erase(it);
+		if (index != bodies.size() - 1)
+		{
+			bodies[index] = bodies.back();
+			indices[bodies[index].body] = index;
+		}
+		bodies.pop_back();
+		airborne.clear();
+	}
+
+	void Aerodynamics::Clear()
+	{
+		bodies.clear();
+		indices.clear();
+		airborne.clear();
+	}
+
+	void Aerodynamics::Apply()
+	{
+		airborne.clear();
+		if (bodies.empty())
+			return;
+
+		//gather the airborne balls
+		for (PxU32 i = 0; i < bodies.size(); i++)
+		{
+			PxRigidDynamic* body = bodies[i].body;
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			if (body->isSleeping() || (body->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC))
+#else
+			if (body->isSleeping() || (body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC))
+#endif
+				continue;
+			if (body->getGlobalPose().p.y - bodies[i].half_length <= parameters.ground_height)
+				continue;
+			airborne.push_back(i);
+		}
+
+		batch.Resize((PxU32)airborne.size());
+		for (PxU32 j = 0; j < airborne.size(); j++)
+		{
+			const Body& entry = bodies[airborne[j]];
+			PxVec3 v = entry.body->getLinearVelocity();
+			PxVec3 w = entry.body->getAngularVelocity();
+			PxVec3 a = entry.body->getGlobalPose().q.getBasisVector0();
+			PxReal r = entry.radius, l = entry.half_length;
+
+			batch.vx[j] = v.x; batch.vy[j] = v.y; batch.vz[j] = v.z;
+			batch.wx[j] = w.x; batch.wy[j] = w.y; batch.wz[j] = w.z;
+			batch.ax[j] = a.x; batch.ay[j] = a.y; batch.az[j] = a.z;
+			batch.axial_area[j] = PxPi * r * r;
+			batch.side_area[j] = PxPi * r * l;
+			batch.magnus_arm[j] = PxPi * r * r * r;
+			batch.tumble_arm[j] = PxPi * r * l * l;
+		}
+
+		Evaluate(batch, parameters);
+
+		//scatter, forces are cleared by PhysX after the next simulate
+		for (PxU32 i = 0; i < airborne.size(); i++)
+		{
+			PxRigidDynamic* body = bodies[airborne[i]].body;
+			body->addForce(PxVec3(batch.fx[i], batch.fy[i], batch.fz[i]));
+			body->addTorque(PxVec3(batch.tx[i], batch.ty[i], batch.tz[i]));
+		}
+	}
+
+	void Aerodynamics::Evaluate(Batch& batch, const Parameters& parameters)
+	{
+		PxReal half_density = .5f * parameters.air_density;
+		const __m128 drag_axial = _mm_set1_ps(half_density * parameters.drag_axial);
+		const __m128 drag_side = _mm_set1_ps(half_density * parameters.drag_side);
+		const __m128 lift = _mm_set1_ps(half_density * parameters.lift);
+		const __m128 tumble = _mm_set1_ps(half_density * parameters.tumble);
+		const __m128 min_speed = _mm_set1_ps(1e-6f);
+
+		for (PxU32 i = 0; i < batch.size; i += 4)
+		{
+			__m128 vx = _mm_loadu_ps(&batch.vx[i]), vy = _mm_loadu_ps(&batch.vy[i]), vz = _mm_loadu_ps(&batch.vz[i]);
+			__m128 wx = _mm_loadu_ps(&batch.wx[i]), wy = _mm_loadu_ps(&batch.wy[i]), wz = _mm_loadu_ps(&batch.wz[i]);
+			__m128 ax = _mm_loadu_ps(&batch.ax[i]), ay = _mm_loadu_ps(&batch.ay[i]), az = _mm_loadu_ps(&batch.az[i]);
+
+			__m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+			__m128 axial_speed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, vx), _mm_mul_ps(ay, vy)), _mm_mul_ps(az, vz));
+
+			//drag: -rho/2 |v| v (Cs As + (Ca Aa - Cs As) cos^2), cos^2 |v| = (a.v)^2 / |v|
+			__m128 side = _mm_mul_ps(drag_side, _mm_loadu_ps(&batch.side_area[i]));
+			__m128 axial = _mm_mul_ps(drag_axial, _mm_loadu_ps(&batch.axial_area[i]));
+			__m128 drag = _mm_add_ps(_mm_mul_ps(side, speed),
+				_mm_div_ps(_mm_mul_ps(_mm_sub_ps(axial, side), _mm_mul_ps(axial_speed, axial_speed)), _mm_max_ps(speed, min_speed)));
+
+			//Magnus: rho/2 Cl pi r^3 (w x v)
+			__m128 magnus = _mm_mul_ps(lift, _mm_loadu_ps(&batch.magnus_arm[i]));
+			__m128 fx = _mm_sub_ps(_mm_mul_ps(magnus, _mm_sub_ps(_mm_mul_ps(wy, vz), _mm_mul_ps(wz, vy))), _mm_mul_ps(drag, vx));
+			__m128 fy = _mm_sub_ps(_mm_mul_ps(magnus, _mm_sub_ps(_mm_mul_ps(wz, vx), _mm_mul_ps(wx, vz))), _mm_mul_ps(drag, vy));
+			__m128 fz = _mm_sub_ps(_mm_mul_ps(magnus, _mm_sub_ps(_mm_mul_ps(wx, vy), _mm_mul_ps(wy, vx))), _mm_mul_ps(drag, vz));
+
+			//overturning moment: rho/2 Ct pi r l^2 (a.v)(v x a), turns the long axis away from the flow
+			__m128 overturn = _mm_mul_ps(_mm_mul_ps(tumble, _mm_loadu_ps(&batch.tumble_arm[i])), axial_speed);
+			__m128 tx = _mm_mul_ps(overturn, _mm_sub_ps(_mm_mul_ps(vy, az), _mm_mul_ps(vz, ay)));
+			__m128 ty = _mm_mul_ps(overturn, _mm_sub_ps(_mm_mul_ps(vz, ax), _mm_mul_ps(vx, az)));
+			__m128 tz = _mm_mul_ps(overturn, _mm_sub_ps(_mm_mul_ps(vx, ay), _mm_mul_ps(vy, ax)));
+
+			_mm_storeu_ps(&batch.fx[i], fx); _mm_storeu_ps(&batch.fy[i], fy); _mm_storeu_ps(&batch.fz[i], fz);
+			_mm_storeu_ps(&batch.tx[i], tx); _mm_storeu_ps(&batch.ty[i], ty); _mm_storeu_ps(&batch.tz[i], tz);
+		}
+	}
+}
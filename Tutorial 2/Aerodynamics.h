@@ -0,0 +1,94 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <unordered_map>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Air forces on prolate (rugby) balls: quadratic drag, Magnus lift from spin and the overturning
+	///moment that tumbles a ball which is not flying point first. The long axis of a ball is its local x axis.
+	///All airborne balls are gathered into a structure of arrays and evaluated 4 at a time with SSE,
+	///the forces are added to the bodies before each simulate call (see Scene::BeginStep).
+	class Aerodynamics
+	{
+	public:
+		struct Parameters
+		{
+			//kg/m^3
+			PxReal air_density;
+			//drag coefficients for flow along and across the long axis
+			PxReal drag_axial;
+			PxReal drag_side;
+			//Magnus lift coefficient
+			PxReal lift;
+			//overturning moment coefficient
+			PxReal tumble;
+			//a ball is airborne when its centre is more than its half length above this height
+			PxReal ground_height;
+
+			Parameters() : air_density(1.225f), drag_axial(.15f), drag_side(.6f), lift(.25f), tumble(.1f), ground_height(0.f) {}
+		};
+
+		///Input and output streams of a batch, padded to a multiple of 4 elements
+		struct Batch
+		{
+			PxU32 size;
+			//linear velocity, angular velocity and long axis
+			std::vector<PxReal> vx, vy, vz, wx, wy, wz, ax, ay, az;
+			//shape terms: pi*r^2, pi*r*l, pi*r^3, pi*r*l^2 (r radius, l half length)
+			std::vector<PxReal> axial_area, side_area, magnus_arm, tumble_arm;
+			//results
+			std::vector<PxReal> fx, fy, fz, tx, ty, tz;
+
+			Batch() : size(0) {}
+
+			///Set the number of elements, the padding is zero
+			void Resize(PxU32 size);
+		};
+
+	private:
+		struct Body
+		{
+			PxRigidDynamic* body;
+			PxReal radius;
+			PxReal half_length;
+		};
+
+		Parameters parameters;
+		std::vector<Body> bodies;
+		//index of each body in bodies
+		std::unordered_map<const PxActor*, PxU32> indices;
+		//indices of the airborne bodies of the last Apply, in batch order
+		std::vector<PxU32> airborne;
+		Batch batch;
+
+	public:
+		///Add a ball, radius across and half length along its local x axis
+		void Add(PxRigidDynamic* body, PxReal radius, PxReal half_length);
+
+		///Remove a ball, nothing happens if it was not added
+		void Remove(const PxActor* body);
+
+		///Remove all balls
+		void Clear();
+
+		void SetParameters(const Parameters& value) { parameters = value; }
+
+		const Parameters& GetParameters() const { return parameters; }
+
+		///Number of balls
+		PxU32 Size() const { return (PxU32)bodies.size(); }
+
+		///Number of balls that were airborne in the last Apply
+		PxU32 Airborne() const { return (PxU32)airborne.size(); }
+
+		///Add the air forces to all airborne balls, call it before every simulate
+		void Apply();
+
+		///Evaluate the forces and torques of a batch
+		static void Evaluate(Batch& batch, const Parameters& parameters);
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "PhysicsEngine.h"
+#include "TrajectoryPredictor.h"
 #include <iostream>
 #include <iomanip>
 
@@ -29,7 +30,7 @@ namespace PhysicsEngine
 		Sphere(const PxTransform& pose = PxTransform(0,4,26), PxReal radius = 1.f, PxReal density = .5f)
 			: DynamicActor(pose)
 		{
-			CreateShape(PxSphereGeometry(radius), density);
+			CreateSharedShape(PxSphereGeometry(radius), density);
 		}
 	};
 
@@ -107,6 +108,9 @@ namespace PhysicsEngine
 	///The ConvexMesh class
 	class ConvexMesh : public DynamicActor
 	{
+		//shared with all actors of the same shape
+		PxConvexMesh* mesh;
+
 	public:
 		//constructor
 		ConvexMesh(const std::vector<PxVec3>& verts, const PxTransform& pose = PxTransform(PxIdentity), PxReal density = 1.f)
@@ -119,26 +123,28 @@ namespace PhysicsEngine
 			mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
 			mesh_desc.vertexLimit = 256;
 
-			CreateShape(PxConvexMeshGeometry(CookMesh(mesh_desc)), density);
+			mesh = CookMesh(mesh_desc);
+			CreateShape(PxConvexMeshGeometry(mesh), density);
 		}
 
-		//mesh cooking (preparation)
-		PxConvexMesh* CookMesh(const PxConvexMeshDesc& mesh_desc)
+		~ConvexMesh()
 		{
-			PxDefaultMemoryOutputStream stream;
-
-			if (!GetCooking()->cookConvexMesh(mesh_desc, stream))
-				throw new Exception("ConvexMesh::CookMesh, cooking failed.");
-
-			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+			GetMeshLibrary().Release(mesh);
+		}
 
-			return GetPhysics()->createConvexMesh(input);
+		//mesh cooking (preparation), each distinct mesh is cooked once and shared
+		PxConvexMesh* CookMesh(const PxConvexMeshDesc& mesh_desc)
+		{
+			return GetMeshLibrary().AcquireConvexMesh(mesh_desc);
 		}
 	};
 
 	///The TriangleMesh class
 	class TriangleMesh : public StaticActor
 	{
+		//shared with all actors of the same shape
+		PxTriangleMesh* mesh;
+
 	public:
 		//constructor
 		TriangleMesh(const std::vector<PxVec3>& verts, const std::vector<PxU32>& trigs, const PxTransform& pose = PxTransform(PxIdentity))
@@ -152,20 +158,19 @@ namespace PhysicsEngine
 			mesh_desc.triangles.stride = 3 * sizeof(PxU32);
 			mesh_desc.triangles.data = &trigs.front();
 
-			CreateShape(PxTriangleMeshGeometry(CookMesh(mesh_desc)));
+			mesh = CookMesh(mesh_desc);
+			CreateShape(PxTriangleMeshGeometry(mesh));
 		}
 
-		//mesh cooking (preparation)
-		PxTriangleMesh* CookMesh(const PxTriangleMeshDesc& mesh_desc)
+		~TriangleMesh()
 		{
-			PxDefaultMemoryOutputStream stream;
-
-			if (!GetCooking()->cookTriangleMesh(mesh_desc, stream))
-				throw new Exception("TriangleMesh::CookMesh, cooking failed.");
-
-			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+			GetMeshLibrary().Release(mesh);
+		}
 
-			return GetPhysics()->createTriangleMesh(input);
+		//mesh cooking (preparation), each distinct mesh is cooked once and shared
+		PxTriangleMesh* CookMesh(const PxTriangleMeshDesc& mesh_desc)
+		{
+			return GetMeshLibrary().AcquireTriangleMesh(mesh_desc);
 		}
 	};
 
@@ -196,16 +201,79 @@ namespace PhysicsEngine
 			// Horizontal (cross bar)
 			GetShape(2)->setLocalPose(PxTransform(PxVec3(0.0f, 6.0f, -80.0f)));
 		}
+
+		///Goal geometry for kick prediction, taken from the shapes at the current pose
+		TrajectoryPredictor::Goal Goal()
+		{
+			PxRigidActor* actor = Get()->is<PxRigidActor>();
+			PxBounds3 left = PxShapeExt::getWorldBounds(*GetShape(0), *actor);
+			PxBounds3 right = PxShapeExt::getWorldBounds(*GetShape(1), *actor);
+			PxBounds3 crossbar = PxShapeExt::getWorldBounds(*GetShape(2), *actor);
+
+			TrajectoryPredictor::Goal goal;
+			goal.line_z = crossbar.getCenter().z;
+			goal.center_x = .5f * (left.getCenter().x + right.getCenter().x);
+			goal.inner_x = right.minimum.x - goal.center_x;
+			goal.outer_x = right.maximum.x - goal.center_x;
+			goal.crossbar_bottom = crossbar.minimum.y;
+			goal.crossbar_top = crossbar.maximum.y;
+			goal.post_top = PxMin(left.maximum.y, right.maximum.y);
+			return goal;
+		}
 	};
 
 
 		//Rugby Ball
 		class RugbyBall : public DynamicActor
 		{
+			//convex spheroid shared with all balls of the same size
+			PxConvexMesh* mesh;
+			//size of the middle ball and distance from the centre to the tips
+			PxReal radius;
+			PxReal half_length;
+
 		public:
+			///Collision shapes of the ball, the long axis is x
+			enum Representation
+			{
+				SPHERE_COMPOUND, //five overlapping spheres
+				CONVEX_SPHEROID, //a single cooked prolate spheroid
+				CAPSULE_HYBRID //a capsule through the tips and a sphere for the belly
+			};
+
+			RugbyBall(const PxTransform& pose = PxTransform(0,4,26), PxReal radius = 0.7f, PxReal density = 0.6f,
+				Representation representation = SPHERE_COMPOUND)
+				: DynamicActor(pose), mesh(0), radius(radius) {
+
+				//tip of the outer spheres (0.85 + 0.3) for the default radius
+				half_length = radius * 1.15f / 0.7f;
 
-			RugbyBall(const PxTransform& pose = PxTransform(0,4,26), PxReal radius = 0.7f, PxReal density = 0.6f)
-				: DynamicActor(pose) {
+				if (representation == CONVEX_SPHEROID)
+				{
+					mesh = CookSpheroid(half_length, radius);
+					CreateSharedShape(PxConvexMeshGeometry(mesh), density);
+					return;
+				}
+
+				if (representation == CAPSULE_HYBRID)
+				{
+					PxReal tip_radius = radius * 0.3f / 0.7f;
+					CreateSharedShape(PxSphereGeometry(radius), density);
+					CreateSharedShape(PxCapsuleGeometry(tip_radius, half_length - tip_radius), density);
+					return;
+				}
+
+				//shared shapes: every ball uses the same five spheres
+				PxVec3 offsets[5] = {
+					//middle ball
+					//PxVec3(0, 1, 3)
+					PxVec3(0, 0, 0),
+					//first outer balls
+					//PxVec3(0.5f, 1, 3), PxVec3(-0.5f, 1, 3)
+					PxVec3(0.5f, 0, 0), PxVec3(-0.5f, 0, 0),
+					//second outer balls
+					//PxVec3(0.85f, 1, 3), PxVec3(-0.85f, 1, 3)
+					PxVec3(0.85f, 0, 0), PxVec3(-0.85f, 0, 0) };
 
 				for (int i = 0; i < 5; i++)
 				{
@@ -217,23 +285,44 @@ namespace PhysicsEngine
 						radius = 0.3f;
 					}
 
-					CreateShape(PxSphereGeometry(radius), density);
+					CreateSharedShape(PxSphereGeometry(radius), density, PxTransform(offsets[i]));
 				}
+			}
+
+			~RugbyBall()
+			{
+				if (mesh)
+					GetMeshLibrary().Release(mesh);
+			}
 
-				//middle ball
-				//GetShape(0)->setLocalPose(PxTransform(PxVec3(0, 1, 3)));
+			PxReal Radius() const { return radius; }
 
-				//first outer balls
-				//GetShape(1)->setLocalPose(PxTransform(PxVec3(0.5f, 1, 3)));
-				//GetShape(2)->setLocalPose(PxTransform(PxVec3(-0.5f, 1, 3)));
-				GetShape(1)->setLocalPose(PxTransform(PxVec3(0.5f, 0, 0)));
-				GetShape(2)->setLocalPose(PxTransform(PxVec3(-0.5f, 0, 0)));
+			PxReal HalfLength() const { return half_length; }
+
+			//prolate spheroid with rings of points around the long (x) axis
+			static PxConvexMesh* CookSpheroid(PxReal half_length, PxReal radius, PxU32 rings = 9, PxU32 segments = 16)
+			{
+				std::vector<PxVec3> verts;
+				verts.push_back(PxVec3(half_length, 0, 0));
+				verts.push_back(PxVec3(-half_length, 0, 0));
+				for (PxU32 i = 1; i <= rings; i++)
+				{
+					PxReal theta = PxPi * i / (rings + 1);
+					for (PxU32 j = 0; j < segments; j++)
+					{
+						PxReal phi = 2.f * PxPi * j / segments;
+						verts.push_back(PxVec3(half_length * PxCos(theta), radius * PxSin(theta) * PxCos(phi), radius * PxSin(theta) * PxSin(phi)));
+					}
+				}
 
-				//second outer balls
-				//GetShape(3)->setLocalPose(PxTransform(PxVec3(0.85f, 1, 3)));
-				//GetShape(4)->setLocalPose(PxTransform(PxVec3(-0.85f, 1, 3)));
-				GetShape(3)->setLocalPose(PxTransform(PxVec3(0.85f, 0, 0)));
-				GetShape(4)->setLocalPose(PxTransform(PxVec3(-0.85f, 0, 0)));
+				PxConvexMeshDesc mesh_desc;
+				mesh_desc.points.count = (PxU32)verts.size();
+				mesh_desc.points.stride = sizeof(PxVec3);
+				mesh_desc.points.data = &verts.front();
+				mesh_desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
+				mesh_desc.vertexLimit = 256;
+
+				return GetMeshLibrary().AcquireConvexMesh(mesh_desc);
 			}
 		};
 
@@ -385,73 +474,37 @@ namespace PhysicsEngine
 
 			class Cloth : public Actor
 			{
-				PxClothMeshDesc mesh_desc;
+				//shared fabric, particles and quads
+				const ClothFabricPool::Fabric* fabric;
 
 			public:
 				//constructor
 				Cloth(PxTransform pose = PxTransform(PxIdentity), const PxVec2& size = PxVec2(1.f, 1.f), PxU32 width = 1, PxU32 height = 1, bool fix_top = true)
 				{
-					//prepare vertices
-					PxReal w_step = size.x / width;
-					PxReal h_step = size.y / height;
-
-					PxClothParticle* vertices = new PxClothParticle[(width + 1) * (height + 1) * 4];
-					PxU32* quads = new PxU32[width * height * 4];
-
-					for (PxU32 j = 0; j < (height + 1); j++)
-					{
-						for (PxU32 i = 0; i < (width + 1); i++)
-						{
-							PxU32 offset = i + j * (width + 1);
-							vertices[offset].pos = PxVec3(w_step * i, 0.f, h_step * j);
-							if (fix_top && (j == 0)) //fix the top row of vertices
-								vertices[offset].invWeight = 0.f;
-							else
-								vertices[offset].invWeight = 1.f;
-						}
-
-						for (PxU32 j = 0; j < height; j++)
-						{
-							for (PxU32 i = 0; i < width; i++)
-							{
-								PxU32 offset = (i + j * width) * 4;
-								quads[offset + 0] = (i + 0) + (j + 0) * (width + 1);
-								quads[offset + 1] = (i + 1) + (j + 0) * (width + 1);
-								quads[offset + 2] = (i + 1) + (j + 1) * (width + 1);
-								quads[offset + 3] = (i + 0) + (j + 1) * (width + 1);
-							}
-						}
-					}
-
-					//init cloth mesh description
-					mesh_desc.points.data = vertices;
-					mesh_desc.points.count = (width + 1) * (height + 1);
-					mesh_desc.points.stride = sizeof(PxClothParticle);
-
-					mesh_desc.invMasses.data = &vertices->invWeight;
-					mesh_desc.invMasses.count = (width + 1) * (height + 1);
-					mesh_desc.invMasses.stride = sizeof(PxClothParticle);
-
-					mesh_desc.quads.data = quads;
-					mesh_desc.quads.count = width * height;
-					mesh_desc.quads.stride = sizeof(PxU32) * 4;
-
-					//create cloth fabric (cooking)
-					PxClothFabric* fabric = PxClothFabricCreate(*GetPhysics(), mesh_desc, PxVec3(0, -1, 0));
+					fabric = &GetClothFabricPool().Get(size, width, height, fix_top);
 
 					//create cloth
-					actor = (PxActor*)GetPhysics()->createCloth(pose, *fabric, vertices, PxClothFlags());
+					actor = (PxActor*)GetPhysics()->createCloth(pose, *fabric->fabric, fabric->particles.data(), PxClothFlags());
 					//collisions with the scene objects
 					((PxCloth*)actor)->setClothFlag(PxClothFlag::eSCENE_COLLISION, true);
 
-					colors.push_back(default_color);
-					actor->userData = new UserData(&colors.back(), &mesh_desc);
+					color_id = GetShapeArena().Allocate(default_color);
+					actor->userData = new UserData(color_id, &fabric->mesh_desc);
 				}
 
 				~Cloth()
 				{
+					GetShapeArena().Free(color_id);
 					delete (UserData*)actor->userData;
 				}
+
+				///Move the cloth and put its particles back into the initial (flat) state
+				void Reset(const PxTransform& pose)
+				{
+					PxCloth* cloth = (PxCloth*)actor;
+					cloth->setGlobalPose(pose);
+					cloth->setParticles(fabric->particles.data(), fabric->particles.data());
+				}
 			};
 
 
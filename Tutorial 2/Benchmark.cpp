@@ -0,0 +1,955 @@
+#include "Benchmark.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <functional>
+
+namespace Benchmark
+{
+	using namespace std;
+	using namespace PhysicsEngine;
+
+	typedef chrono::high_resolution_clock Clock;
+
+	static const PxReal step_time = 1.f/60.f;
+
+	//milliseconds elapsed since start
+	static double Elapsed(const Clock::time_point& start)
+	{
+		return chrono::duration<double, milli>(Clock::now() - start).count();
+	}
+
+	//integer argument at position index or a default value
+	static int Argument(int argc, char** argv, int index, int default_value)
+	{
+		if (index < argc)
+		{
+			int value = atoi(argv[index]);
+			if (value > 0)
+				return value;
+		}
+		return default_value;
+	}
+
+	//average time of a single simulation step, after_step runs after each timed step
+	static double TimeSteps(Scene* scene, PxU32 steps, const function<void()>& after_step = function<void()>())
+	{
+		//let the celebration burst settle into the broadphase first
+		for (PxU32 i = 0; i < 10; i++)
+			scene->Update(step_time);
+
+		Clock::time_point start = Clock::now();
+		for (PxU32 i = 0; i < steps; i++)
+		{
+			scene->Update(step_time);
+			if (after_step)
+				after_step();
+		}
+		return Elapsed(start) / steps;
+	}
+
+	static Actor* NewBrick(const PxTransform& pose)
+	{
+		return new Box(pose);
+	}
+
+	static Actor* NewCannonBall(const PxTransform& pose)
+	{
+		return new CannonBall(pose, 1.f);
+	}
+
+	//bodies dropped at random over the pitch and the castle (120 x 220 m), from height up to 40 m higher;
+	//the same rain for every row
+	static void RainBodies(Scene* scene, PxU32 count, PxReal height, Actor* (*create)(const PxTransform&) = NewBrick)
+	{
+		srand(1);
+		for (PxU32 i = 0; i < count; i++)
+		{
+			PxVec3 position(rand() / (PxReal)RAND_MAX * 120.f - 60.f, height + rand() / (PxReal)RAND_MAX * 40.f, rand() / (PxReal)RAND_MAX * 220.f - 110.f);
+			scene->Add(create(PxTransform(position)));
+		}
+	}
+
+	//a row of the rugby scene benchmarks: settings applied before Init, bodies added after it
+	//and work done after each timed step
+	struct SceneRow
+	{
+		function<void(MyScene*)> configure;
+		function<void(MyScene*)> populate;
+		function<void(MyScene*)> after_step;
+	};
+
+	//results of a row, the statistics of the first step (broadphase insertions) and of the last timed step
+	struct SceneRowResult
+	{
+		double ms;
+		PxSimulationStatistics first;
+		PxSimulationStatistics last;
+	};
+
+	//build the rugby scene of a row, take a first step and time the following steps;
+	//report runs before the scene is deleted
+	static void RunSceneRow(const SceneRow& row, PxU32 steps, const function<void(MyScene*, const SceneRowResult&)>& report)
+	{
+		MyScene* scene = new MyScene();
+		if (row.configure)
+			row.configure(scene);
+		scene->Init();
+		if (row.populate)
+			row.populate(scene);
+
+		SceneRowResult result;
+		scene->Update(step_time);
+		scene->Get()->getSimulationStatistics(result.first);
+
+		result.ms = TimeSteps(scene, steps, [&]() { if (row.after_step) row.after_step(scene); });
+		scene->Get()->getSimulationStatistics(result.last);
+
+		report(scene, result);
+		delete scene;
+	}
+
+	void WorkerScaling(PxU32 max_workers, PxU32 steps)
+	{
+		cout << "Worker scaling, celebration scene, " << steps << " steps" << endl;
+		cout << setw(10) << "workers" << setw(12) << "ms/step" << setw(10) << "speedup" << endl;
+
+		double baseline = 0.;
+		for (PxU32 workers = 1; workers <= max_workers; workers++)
+		{
+			MyScene* scene = new MyScene(workers);
+			scene->Init();
+			scene->spawnCelebrationFlags();
+
+			double ms = TimeSteps(scene, steps);
+			if (workers == 1)
+				baseline = ms;
+
+			cout << setw(10) << scene->WorkerCount() << setw(12) << fixed << setprecision(3) << ms
+				<< setw(10) << setprecision(2) << baseline / ms << endl;
+
+			delete scene;
+		}
+	}
+
+	//shape lookup as done before the shape cache: a fresh vector for every query
+	static PxShape* LegacyGetShape(PxRigidActor* actor, PxU32 index)
+	{
+		std::vector<PxShape*> shapes(actor->getNbShapes());
+		if (index < actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size()))
+			return shapes[index];
+		else
+			return 0;
+	}
+
+	//shape attributes before the ShapeArena
+	struct LegacyUserData
+	{
+		PxVec3* color;
+	};
+
+	//Castle built the way StaticActor::CreateShape worked before the shape cache
+	static PxRigidStatic* LegacyCastle(std::vector<PxVec3>& colors)
+	{
+		PxRigidStatic* actor = GetPhysics()->createRigidStatic(PxTransform(PxIdentity));
+		PxVec3 dimensions(70.0f, 7.0f, 120.0f);
+		PxBoxGeometry geometry[8] = { PxBoxGeometry(dimensions.x, dimensions.y, 1.0f), PxBoxGeometry(dimensions.x, dimensions.y, 1.0f),
+			PxBoxGeometry(1.0f, dimensions.y, dimensions.z), PxBoxGeometry(1.0f, dimensions.y, dimensions.z),
+			PxBoxGeometry(5.0f, 20.0f, 5.0f), PxBoxGeometry(5.0f, 20.0f, 5.0f), PxBoxGeometry(5.0f, 20.0f, 5.0f), PxBoxGeometry(5.0f, 20.0f, 5.0f) };
+
+		colors.clear();
+		for (PxU32 i = 0; i < 8; i++)
+		{
+			PxShape* shape = actor->createShape(geometry[i], *GetMaterial());
+			colors.push_back(default_color);
+			shape->userData = new LegacyUserData();
+			for (PxU32 j = 0; j < colors.size(); j++)
+				((LegacyUserData*)LegacyGetShape(actor, j)->userData)->color = &colors[j];
+		}
+
+		for (PxU32 i = 0; i < 8; i++)
+			LegacyGetShape(actor, i)->setLocalPose(PxTransform(PxVec3((PxReal)i, 0.f, 0.f)));
+
+		return actor;
+	}
+
+	void ActorConstruction(PxU32 count)
+	{
+		cout << "Composite actor construction, " << count << " x Castle (8 shapes)" << endl;
+
+		//previous implementation
+		std::vector<PxRigidStatic*> legacy(count);
+		std::vector<PxVec3> colors;
+		Clock::time_point start = Clock::now();
+		for (PxU32 i = 0; i < count; i++)
+			legacy[i] = LegacyCastle(colors);
+		double legacy_ms = Elapsed(start);
+
+		for (PxU32 i = 0; i < count; i++)
+		{
+			for (PxU32 j = 0; j < 8; j++)
+				delete (LegacyUserData*)LegacyGetShape(legacy[i], j)->userData;
+			legacy[i]->release();
+		}
+
+		//cached shape array
+		std::vector<Castle*> castles(count);
+		start = Clock::now();
+		for (PxU32 i = 0; i < count; i++)
+			castles[i] = new Castle();
+		double cached_ms = Elapsed(start);
+
+		for (PxU32 i = 0; i < count; i++)
+		{
+			PxActor* actor = castles[i]->Get();
+			delete castles[i];
+			actor->release();
+		}
+
+		cout << setw(10) << "version" << setw(12) << "total ms" << setw(14) << "us/actor" << endl;
+		cout << setw(10) << "legacy" << setw(12) << fixed << setprecision(3) << legacy_ms << setw(14) << legacy_ms * 1000. / count << endl;
+		cout << setw(10) << "cached" << setw(12) << fixed << setprecision(3) << cached_ms << setw(14) << cached_ms * 1000. / count << endl;
+	}
+
+	void ResetTiming(PxU32 count)
+	{
+		cout << "Scene reset after a celebration, " << count << " resets" << endl;
+		cout << setw(10) << "mode" << setw(12) << "total ms" << setw(14) << "us/reset" << endl;
+
+		for (PxU32 mode = 0; mode < 2; mode++)
+		{
+			MyScene* scene = new MyScene();
+			scene->FastReset(mode == 1);
+			scene->Init();
+
+			double ms = 0.;
+			for (PxU32 i = 0; i < count; i++)
+			{
+				scene->spawnCelebrationFlags();
+				for (PxU32 j = 0; j < 5; j++)
+					scene->Update(step_time);
+
+				Clock::time_point start = Clock::now();
+				scene->Reset();
+				ms += Elapsed(start);
+			}
+
+			cout << setw(10) << (mode ? "restore" : "rebuild") << setw(12) << fixed << setprecision(3) << ms
+				<< setw(14) << ms * 1000. / count << endl;
+
+			delete scene;
+		}
+	}
+
+	void StartupTiming(const string& filename, PxU32 count)
+	{
+		//reference file
+		{
+			MyScene scene;
+			scene.Init();
+			scene.Save(filename);
+		}
+
+		cout << "Scene startup, " << count << " runs, file " << filename << endl;
+		cout << setw(10) << "mode" << setw(12) << "total ms" << setw(14) << "ms/startup" << endl;
+
+		for (PxU32 mode = 0; mode < 2; mode++)
+		{
+			double ms = 0.;
+			for (PxU32 i = 0; i < count; i++)
+			{
+				Clock::time_point start = Clock::now();
+				MyScene* scene = new MyScene();
+				if (mode == 0)
+					scene->Init();
+				else
+					scene->Load(filename);
+				ms += Elapsed(start);
+				delete scene;
+			}
+
+			cout << setw(10) << (mode ? "load" : "build") << setw(12) << fixed << setprecision(3) << ms
+				<< setw(14) << ms / count << endl;
+		}
+	}
+
+	void MeshCaching(PxU32 count)
+	{
+		//points on a unit sphere
+		vector<PxVec3> verts(256);
+		for (PxU32 i = 0; i < verts.size(); i++)
+		{
+			PxReal z = 1.f - 2.f * (i + .5f) / verts.size();
+			PxReal angle = 2.39996f * i;
+			PxReal r = PxSqrt(1.f - z*z);
+			verts[i] = PxVec3(r * PxCos(angle), r * PxSin(angle), z);
+		}
+
+		cout << "Convex mesh actors, " << verts.size() << " points, " << count << " actors" << endl;
+		cout << setw(10) << "mode" << setw(12) << "total ms" << setw(14) << "us/actor" << endl;
+
+		const char* modes[] = { "cooked", "cached", "shared" };
+		for (PxU32 mode = 0; mode < 3; mode++)
+		{
+			GetMeshCache().Enable(mode > 0);
+			GetMeshLibrary().Enable(mode == 2);
+
+			vector<ConvexMesh*> meshes(count);
+			Clock::time_point start = Clock::now();
+			for (PxU32 i = 0; i < count; i++)
+				meshes[i] = new ConvexMesh(verts);
+			double ms = Elapsed(start);
+
+			for (PxU32 i = 0; i < count; i++)
+			{
+				PxActor* actor = meshes[i]->Get();
+				delete meshes[i];
+				actor->release();
+			}
+
+			cout << setw(10) << modes[mode] << setw(12) << fixed << setprecision(3) << ms
+				<< setw(14) << ms * 1000. / count << endl;
+		}
+
+		GetMeshCache().Enable(true);
+		GetMeshLibrary().Enable(true);
+		cout << "cache: " << GetMeshCache().DiskHits() << " disk hits, " << GetMeshCache().MemoryHits() << " memory hits, "
+			<< GetMeshCache().Misses() << " misses" << endl;
+	}
+
+	//Sphere as it was before the ShapeRegistry
+	class ExclusiveSphere : public DynamicActor
+	{
+	public:
+		ExclusiveSphere(const PxTransform& pose, PxReal radius = 1.f, PxReal density = .5f)
+			: DynamicActor(pose)
+		{
+			CreateShape(PxSphereGeometry(radius), density);
+		}
+	};
+
+	void ShapeSharing(PxU32 count)
+	{
+		cout << "Sphere actors, " << count << " actors" << endl;
+		cout << setw(10) << "mode" << setw(12) << "total ms" << setw(14) << "us/actor" << setw(14) << "bytes/actor" << endl;
+
+		const char* modes[] = { "exclusive", "shared" };
+		for (PxU32 mode = 0; mode < 2; mode++)
+		{
+			size_t bytes = GetAllocator().GetStats().current_bytes;
+
+			vector<DynamicActor*> spheres(count);
+			Clock::time_point start = Clock::now();
+			for (PxU32 i = 0; i < count; i++)
+			{
+				PxTransform pose(PxVec3(0.f, 2.f * i, 0.f));
+				spheres[i] = mode ? (DynamicActor*)new Sphere(pose) : new ExclusiveSphere(pose);
+			}
+			double ms = Elapsed(start);
+			bytes = GetAllocator().GetStats().current_bytes - bytes;
+
+			for (PxU32 i = 0; i < count; i++)
+			{
+				PxActor* actor = spheres[i]->Get();
+				delete spheres[i];
+				actor->release();
+			}
+
+			cout << setw(10) << modes[mode] << setw(12) << fixed << setprecision(3) << ms
+				<< setw(14) << ms * 1000. / count << setw(14) << bytes / count << endl;
+		}
+	}
+
+	//a ground plane for dropping rugby balls
+	class BallScene : public Scene
+	{
+		RugbyBall::Representation representation;
+
+	public:
+		BallScene(RugbyBall::Representation _representation) : Scene(), representation(_representation) {}
+
+		void CustomInit()
+		{
+			Add(new Plane());
+		}
+
+		RugbyBall* AddBall(const PxTransform& pose)
+		{
+			RugbyBall* ball = new RugbyBall(pose, 0.7f, 0.6f, representation);
+			//the rugby ball material of MyScene
+			ball->Material(CreateMaterial(1.16f, 0.65f, 0.828f));
+			Add(ball);
+			return ball;
+		}
+	};
+
+	//drop a tilted ball with some forward speed: height of the first bounce and distance rolled after 5s
+	static void BallFidelity(RugbyBall::Representation representation, PxReal& mass, PxReal& apex, PxReal& roll)
+	{
+		BallScene scene(representation);
+		scene.Init();
+
+		PxVec3 start(0.f, 10.f, 0.f);
+		PxRigidDynamic* body = (PxRigidDynamic*)scene.AddBall(PxTransform(start, PxQuat(PxPi / 6, PxVec3(0.f, 0.f, 1.f))))->Get();
+		body->setLinearVelocity(PxVec3(0.f, 0.f, -5.f));
+		mass = body->getMass();
+
+		//0: falling, 1: rising after the first impact, 2: past the apex
+		PxU32 phase = 0;
+		apex = 0.f;
+		for (PxU32 i = 0; i < 300; i++)
+		{
+			scene.Update(step_time);
+			PxReal height = body->getGlobalPose().p.y;
+			PxReal vertical_speed = body->getLinearVelocity().y;
+			if ((phase == 0) && (vertical_speed > 0.f))
+				phase = 1;
+			if (phase == 1)
+			{
+				apex = PxMax(apex, height);
+				if (vertical_speed < 0.f)
+					phase = 2;
+			}
+		}
+
+		PxVec3 travel = body->getGlobalPose().p - start;
+		roll = PxSqrt(travel.x*travel.x + travel.z*travel.z);
+	}
+
+	void BallRepresentations(PxU32 count, PxU32 steps)
+	{
+		cout << "Rugby ball representations, " << count << " balls, " << steps << " steps" << endl;
+		cout << setw(10) << "mode" << setw(12) << "ms/step" << setw(12) << "pairs/step" << setw(10) << "mass"
+			<< setw(10) << "apex m" << setw(10) << "roll m" << endl;
+
+		const char* modes[] = { "spheres", "convex", "capsule" };
+		for (PxU32 mode = 0; mode < 3; mode++)
+		{
+			RugbyBall::Representation representation = (RugbyBall::Representation)mode;
+
+			//a pile of balls with varying orientations and drop heights
+			BallScene* scene = new BallScene(representation);
+			scene->Init();
+			PxU32 side = (PxU32)PxCeil(PxSqrt((PxReal)count));
+			for (PxU32 i = 0; i < count; i++)
+			{
+				PxVec3 position(3.f * (i % side) - 1.5f * side, 2.f + (i % 7), 3.f * (i / side) - 1.5f * side);
+				scene->AddBall(PxTransform(position, PxQuat(.7f * i, PxVec3(1.f, (PxReal)(i % 3), 1.f).getNormalized())));
+			}
+
+			double ms = TimeSteps(scene, steps);
+
+			//contact pairs once the pile has settled
+			PxSimulationStatistics stats;
+			scene->Get()->getSimulationStatistics(stats);
+			PxU32 pairs = stats.nbDiscreteContactPairsWithContacts;
+			delete scene;
+
+			PxReal mass, apex, roll;
+			BallFidelity(representation, mass, apex, roll);
+
+			cout << setw(10) << modes[mode] << setw(12) << fixed << setprecision(3) << ms << setw(12) << pairs
+				<< setw(10) << setprecision(2) << mass << setw(10) << apex << setw(10) << roll << endl;
+		}
+	}
+
+	//the same model as Aerodynamics::Evaluate, one ball at a time
+	static void EvaluateScalar(Aerodynamics::Batch& batch, const Aerodynamics::Parameters& parameters)
+	{
+		PxReal half_density = .5f * parameters.air_density;
+		for (PxU32 i = 0; i < batch.size; i++)
+		{
+			PxVec3 v(batch.vx[i], batch.vy[i], batch.vz[i]);
+			PxVec3 w(batch.wx[i], batch.wy[i], batch.wz[i]);
+			PxVec3 a(batch.ax[i], batch.ay[i], batch.az[i]);
+			PxReal speed = v.magnitude();
+			PxReal axial_speed = a.dot(v);
+
+			PxReal side = half_density * parameters.drag_side * batch.side_area[i];
+			PxReal axial = half_density * parameters.drag_axial * batch.axial_area[i];
+			PxReal drag = side * speed + (axial - side) * axial_speed * axial_speed / PxMax(speed, 1e-6f);
+			PxVec3 force = w.cross(v) * (half_density * parameters.lift * batch.magnus_arm[i]) - v * drag;
+			PxVec3 torque = v.cross(a) * (half_density * parameters.tumble * batch.tumble_arm[i] * axial_speed);
+
+			batch.fx[i] = force.x; batch.fy[i] = force.y; batch.fz[i] = force.z;
+			batch.tx[i] = torque.x; batch.ty[i] = torque.y; batch.tz[i] = torque.z;
+		}
+	}
+
+	void AerodynamicsTiming(PxU32 count, PxU32 steps)
+	{
+		cout << "Ball aerodynamics, " << count << " balls in flight, " << steps << " steps" << endl;
+
+		//random kicks: speed, spin and orientation
+		Aerodynamics::Parameters parameters;
+		Aerodynamics::Batch batch;
+		batch.Resize(count);
+		srand(1);
+		for (PxU32 i = 0; i < count; i++)
+		{
+			PxVec3 v(rand() / (PxReal)RAND_MAX - .5f, rand() / (PxReal)RAND_MAX, -1.f);
+			PxVec3 w(rand() / (PxReal)RAND_MAX - .5f, rand() / (PxReal)RAND_MAX - .5f, rand() / (PxReal)RAND_MAX - .5f);
+			PxVec3 a = PxVec3(rand() / (PxReal)RAND_MAX - .5f, rand() / (PxReal)RAND_MAX - .5f, rand() / (PxReal)RAND_MAX - .5f).getNormalized();
+			v *= 25.f;
+			w *= 20.f;
+			batch.vx[i] = v.x; batch.vy[i] = v.y; batch.vz[i] = v.z;
+			batch.wx[i] = w.x; batch.wy[i] = w.y; batch.wz[i] = w.z;
+			batch.ax[i] = a.x; batch.ay[i] = a.y; batch.az[i] = a.z;
+			batch.axial_area[i] = PxPi * .7f * .7f;
+			batch.side_area[i] = PxPi * .7f * 1.15f;
+			batch.magnus_arm[i] = PxPi * .7f * .7f * .7f;
+			batch.tumble_arm[i] = PxPi * .7f * 1.15f * 1.15f;
+		}
+
+		cout << setw(10) << "stage" << setw(12) << "ms/step" << setw(14) << "ns/ball" << endl;
+
+		const char* kernels[] = { "scalar", "sse" };
+		vector<PxReal> scalar_fx;
+		for (PxU32 mode = 0; mode < 2; mode++)
+		{
+			Clock::time_point start = Clock::now();
+			for (PxU32 i = 0; i < steps; i++)
+			{
+				if (mode)
+					Aerodynamics::Evaluate(batch, parameters);
+				else
+					EvaluateScalar(batch, parameters);
+			}
+			double ms = Elapsed(start) / steps;
+			cout << setw(10) << kernels[mode] << setw(12) << fixed << setprecision(4) << ms << setw(14) << setprecision(2) << ms * 1e6 / count << endl;
+
+			if (!mode)
+				scalar_fx = batch.fx;
+		}
+
+		//the kernels have to agree
+		PxReal max_error = 0.f;
+		for (PxU32 i = 0; i < count; i++)
+			max_error = PxMax(max_error, PxAbs(batch.fx[i] - scalar_fx[i]) / PxMax(PxAbs(scalar_fx[i]), 1.f));
+
+		//the whole stage on balls high above the ground
+		Scene* scene = new Scene();
+		scene->Init();
+		PxU32 side = (PxU32)PxCeil(PxSqrt((PxReal)count));
+		for (PxU32 i = 0; i < count; i++)
+		{
+			RugbyBall* ball = new RugbyBall(PxTransform(PxVec3(3.f * (i % side), 1000.f, 3.f * (i / side))), .7f, .6f, RugbyBall::CONVEX_SPHEROID);
+			scene->Add(ball);
+			PxRigidDynamic* body = (PxRigidDynamic*)ball->Get();
+			body->setLinearVelocity(PxVec3(batch.vx[i], batch.vy[i], batch.vz[i]));
+			body->setAngularVelocity(PxVec3(batch.wx[i], batch.wy[i], batch.wz[i]));
+			scene->GetAerodynamics().Add(body, ball->Radius(), ball->HalfLength());
+		}
+
+		Clock::time_point start = Clock::now();
+		for (PxU32 i = 0; i < steps; i++)
+			scene->GetAerodynamics().Apply();
+		double ms = Elapsed(start) / steps;
+		cout << setw(10) << "pre-step" << setw(12) << fixed << setprecision(4) << ms << setw(14) << setprecision(2) << ms * 1e6 / count << endl;
+		cout << "airborne: " << scene->GetAerodynamics().Airborne() << ", max relative difference sse/scalar: " << scientific << max_error << endl;
+
+		delete scene;
+	}
+
+	void AggregateTiming(PxU32 count, PxU32 steps)
+	{
+		cout << "Aggregates, rugby scene with " << count << " bricks and the celebration, " << steps << " steps" << endl;
+		cout << setw(12) << "mode" << setw(12) << "ms/step" << setw(12) << "bp adds" << setw(12) << "new pairs" << setw(12) << "contacts" << endl;
+
+		for (PxU32 mode = 0; mode < 2; mode++)
+		{
+			SceneRow row;
+			row.configure = [mode](MyScene* scene) { scene->AggregateActors(mode == 1); };
+			row.populate = [count](MyScene* scene)
+			{
+				scene->spawnCelebrationFlags();
+				RainBodies(scene, count, 5.f);
+			};
+
+			//volumes inserted by the first step (an aggregate is a single volume),
+			//pairs found by the broadphase and contact pairs of the narrowphase in the last step
+			RunSceneRow(row, steps, [mode](MyScene* scene, const SceneRowResult& result)
+			{
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+				PxU32 adds = result.first.getNbBroadPhaseAdds(PxSimulationStatistics::eRIGID_BODY);
+#else
+				PxU32 adds = result.first.getNbBroadPhaseAdds();
+#endif
+				cout << setw(12) << (mode ? "aggregates" : "loose") << setw(12) << fixed << setprecision(3) << result.ms
+					<< setw(12) << adds << setw(12) << result.last.nbNewPairs << setw(12) << result.last.nbDiscreteContactPairsTotal << endl;
+			});
+		}
+	}
+
+	void BatchInsertion(PxU32 count)
+	{
+		cout << "Actor insertion, " << count << " static boxes" << endl;
+		cout << setw(10) << "mode" << setw(12) << "insert ms" << setw(12) << "step ms" << endl;
+
+		const char* modes[] = { "single", "batch", "pruned" };
+		for (PxU32 mode = 0; mode < 3; mode++)
+		{
+			MyScene* scene = new MyScene();
+			scene->Init();
+
+			PxU32 side = (PxU32)PxCeil(PxSqrt((PxReal)count));
+			std::vector<Actor*> boxes(count);
+			for (PxU32 i = 0; i < count; i++)
+				boxes[i] = new blockerBox(PxTransform(PxVec3(12.f * (i % side) - 6.f * side, 13.f, 3.f * (i / side) - 1.5f * side)));
+
+			Clock::time_point start = Clock::now();
+			if (mode == 0)
+			{
+				for (PxU32 i = 0; i < count; i++)
+					scene->Add(boxes[i]);
+			}
+			else
+				scene->AddBatch(boxes, mode == 2);
+			double insert_ms = Elapsed(start);
+
+			//the broadphase and scene query trees are updated by the next step
+			start = Clock::now();
+			scene->Update(step_time);
+			double step_ms = Elapsed(start);
+
+			cout << setw(10) << modes[mode] << setw(12) << fixed << setprecision(3) << insert_ms << setw(12) << step_ms << endl;
+
+			delete scene;
+		}
+	}
+
+	void PoolRecycling(PxU32 count, PxU32 cycles)
+	{
+		cout << "Spawn and despawn cycles, " << count << " spheres, " << cycles << " cycles" << endl;
+		cout << setw(10) << "mode" << setw(12) << "cycle ms" << setw(16) << "allocs/cycle" << setw(14) << "bytes held" << endl;
+
+		const char* modes[] = { "new", "pool" };
+		for (PxU32 mode = 0; mode < 2; mode++)
+		{
+			MyScene* scene = new MyScene();
+			scene->Init();
+			ActorPool<Sphere> pool(scene, count);
+			vector<Sphere*> spheres(count);
+
+			//the first cycle warms up the pool and the scene buffers
+			AllocationStats before;
+			Clock::time_point start;
+			for (PxU32 cycle = 0; cycle <= cycles; cycle++)
+			{
+				if (cycle == 1)
+				{
+					before = GetAllocator().GetStats();
+					start = Clock::now();
+				}
+
+				for (PxU32 i = 0; i < count; i++)
+				{
+					PxTransform pose(PxVec3(3.f * (i % 10), 50.f + 3.f * (i / 10), -200.f));
+					if (mode)
+						spheres[i] = pool.Spawn(pose);
+					else
+					{
+						spheres[i] = new Sphere(pose);
+						scene->Add(spheres[i]);
+					}
+				}
+				scene->Update(step_time);
+				for (PxU32 i = 0; i < count; i++)
+				{
+					if (mode)
+						pool.Release(spheres[i]);
+					else
+						scene->Remove(spheres[i]);
+				}
+			}
+			double ms = Elapsed(start);
+			AllocationStats after = GetAllocator().GetStats();
+
+			cout << setw(10) << modes[mode] << setw(12) << fixed << setprecision(3) << ms / cycles
+				<< setw(16) << (after.total_allocations - before.total_allocations) / cycles
+				<< setw(14) << (long long)after.current_bytes - (long long)before.current_bytes << endl;
+
+			delete scene;
+		}
+	}
+
+	void BroadPhaseTiming(PxU32 count, PxU32 steps)
+	{
+		cout << "Broadphase, rugby scene, " << steps << " steps" << endl;
+		cout << setw(12) << "scenario" << setw(6) << "bp" << setw(12) << "ms/step" << setw(12) << "new pairs" << setw(8) << "lost" << endl;
+
+		const char* scenarios[] = { "celebration", "barrage" };
+		const char* types[] = { "SAP", "MBP" };
+		for (PxU32 scenario = 0; scenario < 2; scenario++)
+		{
+			for (PxU32 type = 0; type < 2; type++)
+			{
+				SceneRow row;
+				row.configure = [type](MyScene* scene) { scene->BroadPhase(type ? PxBroadPhaseType::eMBP : PxBroadPhaseType::eSAP); };
+				row.populate = [scenario, count](MyScene* scene)
+				{
+					//the celebration, or cannon balls dropped all over the castle
+					if (scenario == 0)
+						scene->spawnCelebrationFlags();
+					else
+						RainBodies(scene, count, 10.f, NewCannonBall);
+				};
+
+				RunSceneRow(row, steps, [&](MyScene* scene, const SceneRowResult& result)
+				{
+					cout << setw(12) << scenarios[scenario] << setw(6) << types[type] << setw(12) << fixed << setprecision(3) << result.ms
+						<< setw(12) << result.last.nbNewPairs << setw(8) << scene->OutOfBounds() << endl;
+				});
+			}
+		}
+	}
+
+	void CCDTiming(PxU32 count, PxU32 steps)
+	{
+		const PxU32 shots = 20;
+		cout << "CCD, rugby scene with " << count << " bricks and " << shots << " balls shot at a 0.3 m wall, " << steps << " steps" << endl;
+		cout << setw(10) << "mode" << setw(12) << "ms/step" << setw(12) << "ccd bodies" << setw(12) << "tunnelled" << endl;
+
+		const char* modes[] = { "off", "adaptive", "always" };
+		for (PxU32 mode = 0; mode < 3; mode++)
+		{
+			std::vector<Sphere*> balls(shots);
+			PxU64 ccd_bodies = 0;
+
+			SceneRow row;
+			row.configure = [mode](MyScene* scene) { scene->ContinuousCollision((CCDMode::Enum)mode); };
+			row.populate = [&](MyScene* scene)
+			{
+				//bricks raining over the whole pitch, they never move fast enough for adaptive CCD
+				RainBodies(scene, count, 5.f);
+
+				//a wall as thin as the crossbar and small balls kicked at 80 m/s (1.3 m per step)
+				scene->Add(new blockerBox(PxTransform(0.f, 10.f, -60.f), PxVec3(60.f, 10.f, .15f)));
+				for (PxU32 i = 0; i < shots; i++)
+				{
+					balls[i] = new Sphere(PxTransform(5.f * i - 47.5f, 8.f, -20.f), .3f);
+					scene->Add(balls[i]);
+					((PxRigidDynamic*)balls[i]->Get())->setLinearVelocity(PxVec3(0.f, 2.f, -80.f));
+				}
+			};
+			//CCD bodies per timed step, every dynamic body in the always mode
+			row.after_step = [&](MyScene* scene)
+			{
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+				PxU32 always = (mode == CCDMode::ALWAYS) ? scene->Get()->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC) : 0;
+#else
+				PxU32 always = (mode == CCDMode::ALWAYS) ? scene->Get()->getNbActors(PxActorTypeFlag::eRIGID_DYNAMIC) : 0;
+#endif
+				ccd_bodies += always ? always : scene->GetCCD().Enabled();
+			};
+
+			RunSceneRow(row, steps, [&](MyScene* scene, const SceneRowResult& result)
+			{
+				PxU32 tunnelled = 0;
+				for (PxU32 i = 0; i < shots; i++)
+				{
+					if (((PxRigidDynamic*)balls[i]->Get())->getGlobalPose().p.z < -60.f)
+						tunnelled++;
+				}
+
+				cout << setw(10) << modes[mode] << setw(12) << fixed << setprecision(3) << result.ms
+					<< setw(12) << setprecision(1) << (double)ccd_bodies / steps << setw(12) << tunnelled << endl;
+			});
+		}
+	}
+
+	void QueryBatching(PxU32 count)
+	{
+		cout << "Scene queries, " << count << " line of sight rays and ball sweeps towards the goal" << endl;
+		cout << setw(10) << "mode" << setw(12) << "ray us" << setw(10) << "hits" << setw(12) << "sweep us" << setw(10) << "hits" << endl;
+
+		MyScene* scene = new MyScene();
+		scene->Init();
+		scene->toggleBlocker();
+		scene->Update(step_time);
+
+		//from random points on the pitch to random points in the goal
+		srand(1);
+		std::vector<PxVec3> origins(count), directions(count);
+		std::vector<PxReal> distances(count);
+		for (PxU32 i = 0; i < count; i++)
+		{
+			origins[i] = PxVec3(rand() / (PxReal)RAND_MAX * 100.f - 50.f, 1.f + rand() / (PxReal)RAND_MAX * 5.f, rand() / (PxReal)RAND_MAX * 100.f - 40.f);
+			PxVec3 target(rand() / (PxReal)RAND_MAX * 11.2f - 5.6f, 1.f + rand() / (PxReal)RAND_MAX * 15.f, -80.f);
+			directions[i] = target - origins[i];
+			distances[i] = directions[i].normalize();
+		}
+
+		SceneQueryBatch* batch = new SceneQueryBatch(scene->Get(), count, count);
+		scene->Add(batch);
+
+		for (PxU32 mode = 0; mode < 2; mode++)
+		{
+			PxU32 ray_hits = 0, sweep_hits = 0;
+			double ray_ms, sweep_ms;
+
+			if (mode == 0)
+			{
+				Clock::time_point start = Clock::now();
+				for (PxU32 i = 0; i < count; i++)
+				{
+					PxRaycastBuffer hit;
+					if (scene->Get()->raycast(origins[i], directions[i], distances[i], hit))
+						ray_hits++;
+				}
+				ray_ms = Elapsed(start);
+
+				start = Clock::now();
+				for (PxU32 i = 0; i < count; i++)
+				{
+					PxSweepBuffer hit;
+					if (scene->Get()->sweep(PxSphereGeometry(.7f), PxTransform(origins[i]), directions[i], distances[i], hit))
+						sweep_hits++;
+				}
+				sweep_ms = Elapsed(start);
+			}
+			else
+			{
+				//the buffers are filled once, as a game would do every frame
+				batch->Clear();
+				for (PxU32 i = 0; i < count; i++)
+					batch->AddRay(origins[i], directions[i], distances[i]);
+				Clock::time_point start = Clock::now();
+				batch->Execute();
+				ray_ms = Elapsed(start);
+				for (PxU32 i = 0; i < count; i++)
+					ray_hits += batch->RayHit(i) ? 1 : 0;
+
+				batch->Clear();
+				for (PxU32 i = 0; i < count; i++)
+					batch->AddSweep(origins[i], .7f, directions[i], distances[i]);
+				start = Clock::now();
+				batch->Execute();
+				sweep_ms = Elapsed(start);
+				for (PxU32 i = 0; i < count; i++)
+					sweep_hits += batch->SweepHit(i) ? 1 : 0;
+			}
+
+			cout << setw(10) << (mode ? "batch" : "single") << setw(12) << fixed << setprecision(3) << ray_ms * 1000. / count << setw(10) << ray_hits
+				<< setw(12) << sweep_ms * 1000. / count << setw(10) << sweep_hits << endl;
+		}
+
+		delete scene;
+	}
+
+	void KickPrediction(PxU32 count)
+	{
+		cout << "Kick prediction, " << count << " kicks at the goal" << endl;
+		cout << setw(10) << "mode" << setw(12) << "ms" << setw(12) << "ns/kick" << setw(10) << "goals" << endl;
+
+		//random kicks from the pitch, roughly towards the posts
+		TrajectoryPredictor::Batch batch;
+		batch.Resize(count);
+		srand(1);
+		for (PxU32 i = 0; i < count; i++)
+		{
+			PxVec3 p(rand() / (PxReal)RAND_MAX * 60.f - 30.f, .7f, rand() / (PxReal)RAND_MAX * 60.f - 50.f);
+			PxVec3 v = PxVec3(-p.x, 0.f, -80.f - p.z).getNormalized();
+			PxReal pitch = (20.f + rand() / (PxReal)RAND_MAX * 30.f) * PxPi / 180.f;
+			v = (v * PxCos(pitch) + PxVec3(0.f, PxSin(pitch), 0.f)) * (15.f + rand() / (PxReal)RAND_MAX * 20.f);
+			batch.Set(i, p, v);
+		}
+
+		//the drag of the rugby scene ball
+		TrajectoryPredictor predictor;
+		TrajectoryPredictor::Parameters parameters;
+		parameters.ball_radius = .7f;
+		vector<PxVec3> arc((PxU32)(parameters.max_time / parameters.time_step) + 1);
+
+		const char* modes[] = { "ballistic", "drag", "arc" };
+		for (PxU32 mode = 0; mode < 3; mode++)
+		{
+			parameters.drag = mode ? .002f : 0.f;
+			predictor.SetParameters(parameters);
+
+			PxU32 goals = 0;
+			Clock::time_point start = Clock::now();
+			if (mode < 2)
+			{
+				predictor.Evaluate(batch);
+				for (PxU32 i = 0; i < count; i++)
+					goals += (batch.outcome[i] == TrajectoryPredictor::GOAL) ? 1 : 0;
+			}
+			else
+			{
+				//flight only, no outcome
+				for (PxU32 i = 0; i < count; i++)
+					predictor.Arc(PxVec3(batch.px[i], batch.py[i], batch.pz[i]), PxVec3(batch.vx[i], batch.vy[i], batch.vz[i]), &arc[0], (PxU32)arc.size());
+			}
+			double ms = Elapsed(start);
+
+			cout << setw(10) << modes[mode] << setw(12) << fixed << setprecision(3) << ms << setw(12) << setprecision(1) << ms * 1e6 / count;
+			if (mode < 2)
+				cout << setw(10) << goals;
+			cout << endl;
+		}
+	}
+
+	void Usage()
+	{
+		cout << "Benchmarks:" << endl;
+		cout << "  -bench workers [max_workers] [steps]" << endl;
+		cout << "  -bench actors [count]" << endl;
+		cout << "  -bench reset [count]" << endl;
+		cout << "  -bench startup [count] [file]" << endl;
+		cout << "  -bench meshes [count]" << endl;
+		cout << "  -bench shapes [count]" << endl;
+		cout << "  -bench balls [count] [steps]" << endl;
+		cout << "  -bench aero [count] [steps]" << endl;
+		cout << "  -bench aggregates [count] [steps]" << endl;
+		cout << "  -bench batch [count]" << endl;
+		cout << "  -bench pool [count] [cycles]" << endl;
+		cout << "  -bench broadphase [count] [steps]" << endl;
+		cout << "  -bench ccd [count] [steps]" << endl;
+		cout << "  -bench queries [count]" << endl;
+		cout << "  -bench kicks [count]" << endl;
+	}
+
+	bool Run(const string& name, int argc, char** argv)
+	{
+		//arguments following the benchmark name
+		argc -= 3;
+		argv += 3;
+
+		if (name == "workers")
+			WorkerScaling(Argument(argc, argv, 0, PxMax(thread::hardware_concurrency(), 1u)), Argument(argc, argv, 1, 300));
+		else if (name == "actors")
+			ActorConstruction(Argument(argc, argv, 0, 10000));
+		else if (name == "reset")
+			ResetTiming(Argument(argc, argv, 0, 100));
+		else if (name == "meshes")
+			MeshCaching(Argument(argc, argv, 0, 100));
+		else if (name == "shapes")
+			ShapeSharing(Argument(argc, argv, 0, 1000));
+		else if (name == "balls")
+			BallRepresentations(Argument(argc, argv, 0, 500), Argument(argc, argv, 1, 300));
+		else if (name == "aero")
+			AerodynamicsTiming(Argument(argc, argv, 0, 4000), Argument(argc, argv, 1, 100));
+		else if (name == "aggregates")
+			AggregateTiming(Argument(argc, argv, 0, 500), Argument(argc, argv, 1, 300));
+		else if (name == "batch")
+			BatchInsertion(Argument(argc, argv, 0, 2000));
+		else if (name == "pool")
+			PoolRecycling(Argument(argc, argv, 0, 100), Argument(argc, argv, 1, 200));
+		else if (name == "broadphase")
+			BroadPhaseTiming(Argument(argc, argv, 0, 500), Argument(argc, argv, 1, 300));
+		else if (name == "ccd")
+			CCDTiming(Argument(argc, argv, 0, 500), Argument(argc, argv, 1, 300));
+		else if (name == "queries")
+			QueryBatching(Argument(argc, argv, 0, 10000));
+		else if (name == "kicks")
+			KickPrediction(Argument(argc, argv, 0, 10000));
+		else if (name == "startup")
+			StartupTiming((argc > 1) ? argv[1] : "rugby.scene", Argument(argc, argv, 0, 20));
+		else
+			return false;
+
+		return true;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "MyPhysicsEngine.h"
+#include <string>
+
+///Headless performance measurements of the rugby scene.
+///Run as: "Tutorial 2.exe" -bench <name> [arguments]
+namespace Benchmark
+{
+	using namespace physx;
+
+	///Run a benchmark by name, returns false if the name is unknown
+	bool Run(const std::string& name, int argc, char** argv);
+
+	///Print the list of available benchmarks
+	void Usage();
+
+	///ms/step of the celebration scene for 1..max_workers simulation threads
+	void WorkerScaling(PxU32 max_workers, PxU32 steps=300);
+
+	///Construction time of composite actors (Castle, 8 shapes) with the cached shape array
+	///against the previous per-call getShapes queries
+	void ActorConstruction(PxU32 count=10000);
+
+	///Scene::Reset after a celebration (2 cloths, 100 spheres): fast restore against a full rebuild
+	void ResetTiming(PxU32 count=100);
+
+	///Startup time of the rugby scene: procedural construction against loading the saved binary file
+	void StartupTiming(const std::string& filename, PxU32 count=20);
+
+	///Construction time of convex mesh actors (a 256 point hull): cooking every time,
+	///loading from the mesh cache and sharing a single mesh from the mesh library
+	void MeshCaching(PxU32 count=100);
+
+	///Construction time and PhysX memory of sphere actors (the celebration burst):
+	///an exclusive shape per actor against a single shared shape from the ShapeRegistry
+	void ShapeSharing(PxU32 count=1000);
+
+	///Cost and fidelity of the RugbyBall representations: ms/step and contact pairs of a pile of balls,
+	///mass, first bounce height and rolling distance of a single ball
+	void BallRepresentations(PxU32 count=500, PxU32 steps=300);
+
+	///Air forces of a batch kick: the SSE kernel against a scalar loop,
+	///and the full pre-step stage (gather, evaluate, add forces) for balls in flight
+	void AerodynamicsTiming(PxU32 count=4000, PxU32 steps=100);
+
+	///ms/step, broadphase volumes and pairs of the rugby scene with a burst of bricks and the celebration spheres,
+	///with and without aggregates for the pitch furniture and the seesaw
+	void AggregateTiming(PxU32 count=500, PxU32 steps=300);
+
+	///Insertion of a burst of static boxes and the following step: Add for each actor,
+	///a single AddBatch and AddBatch with a pruning structure
+	void BatchInsertion(PxU32 count=2000);
+
+	///Spawn and despawn cycles of the celebration spheres: new and Remove against an ActorPool,
+	///time and PhysX allocations per cycle once warm, and the PhysX bytes still held after the cycles
+	void PoolRecycling(PxU32 count=100, PxU32 cycles=200);
+
+	///ms/step of the rugby scene with the SAP and the MBP broadphase (regions over the pitch),
+	///under the celebration burst and a barrage of cannon balls over the castle
+	void BroadPhaseTiming(PxU32 count=500, PxU32 steps=300);
+
+	///ms/step of the rugby scene with a burst of bricks and a volley of fast balls shot at a thin wall:
+	///CCD off, adaptive (fast bodies only) and on for every body, with the balls that went through the wall
+	void CCDTiming(PxU32 count=500, PxU32 steps=300);
+
+	///Line of sight rays and ball sweeps from the pitch towards the goal (blocker up):
+	///individual PxScene calls against a SceneQueryBatch
+	void QueryBatching(PxU32 count=10000);
+
+	///Kick prediction of random kicks at the goal: the SSE predictor without and with drag,
+	///against stepping the flight of each kick one at a time (TrajectoryPredictor::Arc)
+	void KickPrediction(PxU32 count=10000);
+}
@@ -0,0 +1,103 @@
+#include "ClothFabricPool.h"
+#include "PhysicsEngine.h"
+
+namespace PhysicsEngine
+{
+	bool ClothFabricPool::Key::operator<(const Key& other) const
+	{
+		if (width != other.width) return width < other.width;
+		if (height != other.height) return height < other.height;
+		if (size_x != other.size_x) return size_x < other.size_x;
+		if (size_y != other.size_y) return size_y < other.size_y;
+		return fix_top < other.fix_top;
+	}
+
+	ClothFabricPool::~ClothFabricPool()
+	{
+		//the fabrics themselves went with the SDK (see Clear)
+		for (std::map<Key, Fabric*>::iterator it = fabrics.begin(); it != fabrics.end(); ++it)
+			delete it->second;
+	}
+
+	const ClothFabricPool::Fabric& ClothFabricPool::Get(const PxVec2& size, PxU32 width, PxU32 height, bool fix_top)
+	{
+		Key key = { width, height, size.x, size.y, fix_top };
+		std::map<Key, Fabric*>::iterator it = fabrics.find(key);
+		if (it != fabrics.end())
+			return *it->second;
+
+		Fabric* fabric = new Fabric();
+
+		//prepare vertices
+		PxReal w_step = size.x / width;
+		PxReal h_step = size.y / height;
+
+		fabric->particles.resize((width + 1) * (height + 1));
+		for (PxU32 j = 0; j < (height + 1); j++)
+		{
+			for (PxU32 i = 0; i < (width + 1); i++)
+			{
+				PxU32 offset = i + j * (width + 1);
+				fabric->particles[offset].pos = PxVec3(w_step * i, 0.f, h_step * j);
+				if (fix_top && (j == 0)) //fix the top row of vertices
+					fabric->particles[offset].invWeight = 0.f;
+				else
+					fabric->particles[offset].invWeight = 1.f;
+			}
+		}
+
+		fabric->quads.resize(width * height * 4);
+		for (PxU32 j = 0; j < height; j++)
+		{
+			for (PxU32 i = 0; i < width; i++)
+			{
+				PxU32 offset = (i + j * width) * 4;
+				fabric->quads[offset + 0] = (i + 0) + (j + 0) * (width + 1);
+				fabric->quads[offset + 1] = (i + 1) + (j + 0) * (width + 1);
+				fabric->quads[offset + 2] = (i + 1) + (j + 1) * (width + 1);
+				fabric->quads[offset + 3] = (i + 0) + (j + 1) * (width + 1);
+			}
+		}
+
+		//init cloth mesh description
+		PxClothMeshDesc& mesh_desc = fabric->mesh_desc;
+		mesh_desc.points.data = fabric->particles.data();
+		mesh_desc.points.count = (PxU32)fabric->particles.size();
+		mesh_desc.points.stride = sizeof(PxClothParticle);
+
+		mesh_desc.invMasses.data = &fabric->particles.front().invWeight;
+		mesh_desc.invMasses.count = (PxU32)fabric->particles.size();
+		mesh_desc.invMasses.stride = sizeof(PxClothParticle);
+
+		mesh_desc.quads.data = fabric->quads.data();
+		mesh_desc.quads.count = width * height;
+		mesh_desc.quads.stride = sizeof(PxU32) * 4;
+
+		//create cloth fabric (cooking)
+		fabric->fabric = PxClothFabricCreate(*GetPhysics(), mesh_desc, PxVec3(0, -1, 0));
+		if (!fabric->fabric)
+		{
+			delete fabric;
+			throw new Exception("ClothFabricPool::Get, Could not create the cloth fabric.");
+		}
+
+		fabrics[key] = fabric;
+		return *fabric;
+	}
+
+	void ClothFabricPool::Clear()
+	{
+		for (std::map<Key, Fabric*>::iterator it = fabrics.begin(); it != fabrics.end(); ++it)
+		{
+			it->second->fabric->release();
+			delete it->second;
+		}
+		fabrics.clear();
+	}
+
+	ClothFabricPool& GetClothFabricPool()
+	{
+		static ClothFabricPool pool;
+		return pool;
+	}
+}
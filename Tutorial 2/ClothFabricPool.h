@@ -0,0 +1,55 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <map>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Cloth fabrics shared by all cloths with the same grid.
+	///A fabric is cooked once per (width, height, size, fixed top row), its particles and quads
+	///are kept with it and used by every cloth built from it (initial state and rendering).
+	class ClothFabricPool
+	{
+	public:
+		struct Fabric
+		{
+			PxClothFabric* fabric;
+			//initial particles in the cloth frame
+			std::vector<PxClothParticle> particles;
+			//4 indices per quad
+			std::vector<PxU32> quads;
+			//points to the vectors above
+			PxClothMeshDesc mesh_desc;
+		};
+
+	private:
+		struct Key
+		{
+			PxU32 width, height;
+			PxReal size_x, size_y;
+			bool fix_top;
+
+			bool operator<(const Key& other) const;
+		};
+
+		std::map<Key, Fabric*> fabrics;
+
+	public:
+		~ClothFabricPool();
+
+		///Get the fabric for a width x height grid of the given size, cooked on first use
+		const Fabric& Get(const PxVec2& size, PxU32 width, PxU32 height, bool fix_top);
+
+		///Release the pool references (cloths keep theirs)
+		void Clear();
+
+		///Number of distinct fabrics
+		PxU32 Size() const { return (PxU32)fabrics.size(); }
+	};
+
+	///The pool used by Cloth
+	ClothFabricPool& GetClothFabricPool();
+}
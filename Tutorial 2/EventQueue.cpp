@@ -0,0 +1,69 @@
+#include "EventQueue.h"
+#include <chrono>
+
+namespace PhysicsEngine
+{
+	static void CopyName(char* name, size_t size, const PxActor* actor)
+	{
+		const char* source = actor ? actor->getName() : 0;
+		if (!source)
+			source = "";
+		size_t i = 0;
+		for (; (i < size - 1) && source[i]; i++)
+			name[i] = source[i];
+		name[i] = 0;
+	}
+
+	SimulationEvent::SimulationEvent(Type _type, const PxActor* actor0, const PxActor* actor1) : type(_type)
+	{
+		CopyName(names[0], sizeof(names[0]), actor0);
+		CopyName(names[1], sizeof(names[1]), actor1);
+	}
+
+	EventLog::EventLog(std::ostream& _out) : out(_out), running(true), lost(0), reported(0)
+	{
+		thread = std::thread(&EventLog::Run, this);
+	}
+
+	EventLog::~EventLog()
+	{
+		running = false;
+		thread.join();
+	}
+
+	void EventLog::Run()
+	{
+		SimulationEvent event;
+		while (true)
+		{
+			//read the flag first so that nothing pushed before the stop is lost
+			bool stop = !running.load();
+			bool written = false;
+			while (queue.Pop(event))
+			{
+				Write(event);
+				written = true;
+			}
+
+			//events that never made it into the log
+			PxU32 dropped = queue.Dropped() + lost.load(std::memory_order_relaxed);
+			if (dropped != reported)
+			{
+				out << (dropped - reported) << " events dropped, the queue was full\n";
+				reported = dropped;
+				written = true;
+			}
+			if (written)
+				out.flush();
+			if (stop)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+
+	void EventLog::Write(const SimulationEvent& event)
+	{
+		static const char* types[] = { "contact found", "contact lost", "trigger found", "trigger lost" };
+		out << types[event.type] << ": " << event.names[0] << " " << event.names[1] << "\n";
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Single-producer, single-consumer ring buffer with a fixed capacity (a power of 2).
+	///Push and Pop never block or allocate, Push fails when the ring is full.
+	template<class T, PxU32 capacity>
+	class RingBuffer
+	{
+		static_assert((capacity & (capacity - 1)) == 0, "RingBuffer capacity must be a power of 2");
+
+		//next element to pop and next free slot, both only grow
+		std::atomic<PxU32> head;
+		std::atomic<PxU32> tail;
+		T items[capacity];
+
+	public:
+		RingBuffer() : head(0), tail(0) {}
+
+		///Producer only: returns false if the ring is full
+		bool Push(const T& item)
+		{
+			PxU32 t = tail.load(std::memory_order_relaxed);
+			if (t - head.load(std::memory_order_acquire) == capacity)
+				return false;
+			items[t & (capacity - 1)] = item;
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		///Consumer only: returns false if the ring is empty
+		bool Pop(T& item)
+		{
+			PxU32 h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire))
+				return false;
+			item = items[h & (capacity - 1)];
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+		///Number of queued elements (approximate while the other side runs)
+		PxU32 Size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+	};
+
+	///A contact or trigger event recorded by the simulation callback.
+	///Actor names are copied, the actors may be released before the event is read.
+	struct SimulationEvent
+	{
+		enum Type { CONTACT_FOUND, CONTACT_LOST, TRIGGER_FOUND, TRIGGER_LOST };
+
+		PxU32 type;
+		char names[2][28];
+
+		SimulationEvent() : type(CONTACT_FOUND) { names[0][0] = names[1][0] = 0; }
+
+		SimulationEvent(Type _type, const PxActor* actor0, const PxActor* actor1);
+	};
+
+	///Events pushed by the simulation callback (inside fetchResults) and drained once per frame
+	class SimulationEventQueue
+	{
+		RingBuffer<SimulationEvent, 4096> events;
+		//events lost to a full queue
+		std::atomic<PxU32> dropped;
+
+	public:
+		SimulationEventQueue() : dropped(0) {}
+
+		///Producer: queue an event, it is dropped if the queue is full
+		void Push(const SimulationEvent& event)
+		{
+			if (!events.Push(event))
+				dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		///Consumer: returns false if there are no events
+		bool Pop(SimulationEvent& event) { return events.Pop(event); }
+
+		///Number of events dropped so far
+		PxU32 Dropped() const { return dropped.load(std::memory_order_relaxed); }
+	};
+
+	///Writes events as text lines on a background thread, so console output never stalls the simulation
+	class EventLog
+	{
+		SimulationEventQueue queue;
+		std::ostream& out;
+		std::atomic<bool> running;
+		std::thread thread;
+		//events lost before they reached the log (see Lost)
+		std::atomic<PxU32> lost;
+		//drops written so far, only used by the thread
+		PxU32 reported;
+
+		void Run();
+
+		void Write(const SimulationEvent& event);
+
+	public:
+		EventLog(std::ostream& out=std::cerr);
+
+		///Writes the remaining events and stops the thread
+		~EventLog();
+
+		///Queue an event for writing, call it from a single thread
+		void Push(const SimulationEvent& event) { queue.Push(event); }
+
+		///Number of events dropped because the writer fell behind
+		PxU32 Dropped() const { return queue.Dropped(); }
+
+		///Report events lost upstream (e.g. a full simulation queue), they are counted in the log output
+		void Lost(PxU32 count) { lost.fetch_add(count, std::memory_order_relaxed); }
+	};
+}
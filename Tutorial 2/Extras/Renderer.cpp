@@ -2,6 +2,7 @@
 #include <iostream>
 #include <vector>
 #include "UserData.h"
+#include "TaskScheduler.h"
 
 using namespace std;
 
@@ -156,28 +157,67 @@ namespace VisualDebugger
 			}
 		}
 
-		void RenderCloth(const PxCloth* cloth)
+		//cloth vertices and normals prepared for drawing
+		struct ClothItem
 		{
-			PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
-			PxVec3* color = ((UserData*)cloth->userData)->color;
+			const PxCloth* cloth;
+			PxTransform pose;
+			//snapshot particles, 0 = read them from the cloth
+			const PxVec3* particles;
+			std::vector<PxVec3> verts;
+			std::vector<PxVec3> norms;
+		};
+
+		//a single rigid shape prepared for drawing
+		struct ShapeItem
+		{
+			PxMat44 pose;
+			PxGeometryHolder geometry;
+			//render attributes in the ShapeArena
+			PxU32 id;
+		};
+
+		//render list, rebuilt every frame but the storage is kept
+		std::vector<PxU32> actor_offsets;
+		std::vector<ShapeItem> shape_items;
+		std::vector<ClothItem> cloth_items;
+		PhysicsEngine::TaskScheduler* scheduler = 0;
+
+		//copy particle positions and compute the vertex normals (no GL calls, can run on any thread)
+		void PrepareCloth(ClothItem& item)
+		{
+			const PxCloth* cloth = item.cloth;
+			const PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
 
 			PxU32 quad_count = mesh_desc->quads.count;
-			PxU32* quads = (PxU32*)mesh_desc->quads.data;
+			const PxU32* quads = (const PxU32*)mesh_desc->quads.data;
 
-			std::vector<PxVec3> verts(cloth->getNbParticles());
-			std::vector<PxVec3> norms(verts.size(), PxVec3(0.f,0.f,0.f));
+			item.verts.resize(cloth->getNbParticles());
+			item.norms.assign(item.verts.size(), PxVec3(0.f,0.f,0.f));
 
-			//get verts data
-			cloth->lockParticleData();
+			if (item.particles)
+			{
+				item.verts.assign(item.particles, item.particles + item.verts.size());
+			}
+			else
+			{
+				//get verts data
+				item.pose = cloth->getGlobalPose();
+				PxClothParticleData* particle_data = cloth->lockParticleData();
+				if (!particle_data)
+				{
+					item.verts.clear();
+					return;
+				}
+				// copy vertex positions
+				for (PxU32 j = 0; j < item.verts.size(); j++)
+					item.verts[j] = particle_data->particles[j].pos;
 
-			PxClothParticleData* particle_data = cloth->lockParticleData();
-			if (!particle_data)
-				return;
-			// copy vertex positions
-			for (PxU32 j = 0; j < verts.size(); j++)
-				verts[j] = particle_data->particles[j].pos;
+				particle_data->unlock();
+			}
 
-			particle_data->unlock();
+			std::vector<PxVec3>& verts = item.verts;
+			std::vector<PxVec3>& norms = item.norms;
 
 			for (PxU32 i = 0; i < quad_count*4; i+=4)
 			{
@@ -194,9 +234,21 @@ namespace VisualDebugger
 
 			for (PxU32 i = 0; i < norms.size(); i++)
 				norms[i].normalize();
+		}
 
-			PxTransform pose = cloth->getGlobalPose();
-			PxMat44 shapePose(pose);
+		void RenderCloth(const ClothItem& item)
+		{
+			const PxCloth* cloth = item.cloth;
+			if (!item.verts.size())
+				return;
+
+			const PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
+			const PxVec3* color = &GetShapeArena().Color(((UserData*)cloth->userData)->color_id);
+
+			PxU32 quad_count = mesh_desc->quads.count;
+			const PxU32* quads = (const PxU32*)mesh_desc->quads.data;
+
+			PxMat44 shapePose(item.pose);
 
 			glColor4f(color->x, color->y, color->z, 1.f);
 
@@ -206,8 +258,8 @@ namespace VisualDebugger
 			glEnableClientState(GL_VERTEX_ARRAY);
 			glEnableClientState(GL_NORMAL_ARRAY);
 
-			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &verts.front());
-			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &norms.front());
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &item.verts.front());
+			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &item.norms.front());
 
 			glDrawElements(GL_QUADS, quad_count*4, GL_UNSIGNED_INT, quads);
 
@@ -286,82 +338,161 @@ namespace VisualDebugger
 			background_color = PxVec3(0.5f,0.8f,0.9f); //change skybox to blue for daytime
 		}
 
+		void SetTaskScheduler(PhysicsEngine::TaskScheduler* value)
+		{
+			scheduler = value;
+		}
+
+		//fill the render list entries of a single rigid actor
+		void PrepareActor(PxRigidActor* actor, const PxTransform* actor_pose, PxU32 index)
+		{
+			PxU32 nb_shapes = actor_offsets[index+1] - actor_offsets[index];
+
+			for (PxU32 j = 0; j < nb_shapes; j++)
+			{
+				PxShape* shape;
+				actor->getShapes(&shape, 1, j);
+				ShapeItem& item = shape_items[actor_offsets[index] + j];
+
+				PxTransform pose = actor_pose ? (*actor_pose) * shape->getLocalPose() : PxShapeExt::getGlobalPose(*shape, *actor);
+				item.geometry = shape->getGeometry();
+				//move the plane slightly down to avoid visual artefacts
+				if (item.geometry.getType() == PxGeometryType::ePLANE)
+				{
+					pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
+					pose.p += PxVec3(0,-0.01,0);
+				}
+				item.pose = PxMat44(pose);
+				item.id = GetShapeId(shape, actor);
+			}
+		}
+
 		void Render(PxActor** actors, const PxU32 numActors)
 		{
-			PxVec3 shadow_color = default_color*0.9;
-			for(PxU32 i=0;i<numActors;i++) {
+			Render(actors, 0, 0, 0, numActors);
+		}
+
+		void Render(PxActor** actors, const PxTransform* poses, const PxU32* particle_offsets, const PxVec3* particles, const PxU32 numActors)
+		{
+			//lay out the render list: a range of shapes for each rigid actor, a slot for each cloth
+			actor_offsets.resize(numActors+1);
+			PxU32 nb_shapes = 0, nb_cloths = 0;
+			for (PxU32 i = 0; i < numActors; i++)
+			{
+				actor_offsets[i] = nb_shapes;
 #if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
 				if (actors[i]->isCloth()) {
 #else
 				if (actors[i]->is<PxCloth>()) {
 #endif
-					RenderCloth((PxCloth*)actors[i]);
+					if (cloth_items.size() <= nb_cloths)
+						cloth_items.resize(nb_cloths+1);
+					ClothItem& item = cloth_items[nb_cloths++];
+					item.cloth = (PxCloth*)actors[i];
+					item.particles = particles ? particles + particle_offsets[i] : 0;
+					if (poses)
+						item.pose = poses[i];
 				}
 #if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
 				else if (actors[i]->isRigidActor()) {
 #else
 				else if (actors[i]->is<PxRigidActor>()) {
 #endif
-					PxRigidActor* rigid_actor = (PxRigidActor*)actors[i];
-					std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
-					rigid_actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
+					nb_shapes += ((PxRigidActor*)actors[i])->getNbShapes();
+				}
+			}
+			actor_offsets[numActors] = nb_shapes;
+			shape_items.resize(nb_shapes);
+
+			//gather poses, colours and cloth normals on the worker threads
+			std::function<void(PxU32, PxU32)> prepare_cloths = [](PxU32 begin, PxU32 end)
+			{
+				for (PxU32 i = begin; i < end; i++)
+					PrepareCloth(cloth_items[i]);
+			};
+			std::function<void(PxU32, PxU32)> prepare_actors = [actors, poses](PxU32 begin, PxU32 end)
+			{
+				for (PxU32 i = begin; i < end; i++)
+				{
+					if (actor_offsets[i+1] > actor_offsets[i])
+						PrepareActor((PxRigidActor*)actors[i], poses ? &poses[i] : 0, i);
+				}
+			};
+
+			if (scheduler)
+			{
+				scheduler->ParallelFor(nb_cloths, 1, prepare_cloths);
+				scheduler->ParallelFor(numActors, 32, prepare_actors);
+			}
+			else
+			{
+				prepare_cloths(0, nb_cloths);
+				prepare_actors(0, numActors);
+			}
+
+			//issue the GL calls
+			const PxVec3* colors = GetShapeArena().Colors();
+			const PxU32* flags = GetShapeArena().Flags();
+			PxVec3 shadow_color = default_color*0.9;
+			PxU32 cloth_index = 0;
+			for(PxU32 i=0;i<numActors;i++) {
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+				if (actors[i]->isCloth()) {
+#else
+				if (actors[i]->is<PxCloth>()) {
+#endif
+					RenderCloth(cloth_items[cloth_index++]);
+					continue;
+				}
 
-					for(PxU32 j = 0; j < shapes.size(); j++)
+				for(PxU32 j = actor_offsets[i]; j < actor_offsets[i+1]; j++)
+				{
+					const ShapeItem& item = shape_items[j];
+					const PxGeometryHolder& h = item.geometry;
+
+					// render object
+					glPushMatrix();						
+					glMultMatrixf((float*)&item.pose);
+
+					PxVec3 shape_color = default_color;
+
+					if (item.id != ShapeArena::invalid_id)
 					{
-						const PxShape* shape = shapes[j];
-						PxTransform pose = PxShapeExt::getGlobalPose(*shape, *shape->getActor());
-						PxGeometryHolder h = shape->getGeometry();
-						//move the plane slightly down to avoid visual artefacts
+						shape_color = colors[item.id];
+						if (flags[item.id] & RenderFlag::HIGHLIGHT)
+							shape_color += PxVec3(.2f,.2f,.2f);
 						if (h.getType() == PxGeometryType::ePLANE)
 						{
-							pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
-							pose.p += PxVec3(0,-0.01,0);
+							shadow_color = shape_color*0.9;
 						}
+					}
 
-						PxMat44 shapePose(pose);
-						// render object
-						glPushMatrix();						
-						glMultMatrixf((float*)&shapePose);
+					if (h.getType() == PxGeometryType::ePLANE)
+						glDisable(GL_LIGHTING);
 
-						PxVec3 shape_color = default_color;
+					glColor4f(shape_color.x, shape_color.y, shape_color.z, 1.f);
 
-						if (shape->userData)
-						{
-							shape_color = *(((UserData*)shape->userData)->color);
-							if (h.getType() == PxGeometryType::ePLANE)
-							{
-								shadow_color = shape_color*0.9;
-							}
-						}
+					RenderGeometry(h);
 
-						if (h.getType() == PxGeometryType::ePLANE)
-							glDisable(GL_LIGHTING);
+					if (h.getType() == PxGeometryType::ePLANE)
+						glEnable(GL_LIGHTING);
 
-						glColor4f(shape_color.x, shape_color.y, shape_color.z, 1.f);
+					glPopMatrix();
 
+					if(show_shadows && (h.getType() != PxGeometryType::ePLANE))
+					{
+						const PxVec3 shadowDir(-0.7071067f, -0.7071067f, -0.7071067f);
+						const PxReal shadowMat[]={ 1,0,0,0, -shadowDir.x/shadowDir.y,0,-shadowDir.z/shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
+						glPushMatrix();						
+						glMultMatrixf(shadowMat);
+						glMultMatrixf((float*)&item.pose);
+						glDisable(GL_LIGHTING);
+						glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
 						RenderGeometry(h);
-
-						if (h.getType() == PxGeometryType::ePLANE)
-							glEnable(GL_LIGHTING);
-
+						glEnable(GL_LIGHTING);
 						glPopMatrix();
-
-						if(show_shadows && (h.getType() != PxGeometryType::ePLANE))
-						{
-							const PxVec3 shadowDir(-0.7071067f, -0.7071067f, -0.7071067f);
-							const PxReal shadowMat[]={ 1,0,0,0, -shadowDir.x/shadowDir.y,0,-shadowDir.z/shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
-							glPushMatrix();						
-							glMultMatrixf(shadowMat);
-							glMultMatrixf((float*)&shapePose);
-							glDisable(GL_LIGHTING);
-							glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
-							RenderGeometry(h);
-							glEnable(GL_LIGHTING);
-							glPopMatrix();
-						}
 					}
 				}
-
 			}
 		}
 
@@ -506,6 +637,22 @@ namespace VisualDebugger
 			//TODO: render texts ?
 		}
 
+		void RenderLines(const PxVec3* points, PxU32 count, const PxVec3& color, PxReal line_width)
+		{
+			if (count < 2)
+				return;
+
+			//unlit, the color is shown as it is; a single color, so the points are drawn in place
+			glLineWidth(line_width);
+			glDisable(GL_LIGHTING);
+			glColor4f(color.x, color.y, color.z, 1.f);
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), points);
+			glDrawArrays(GL_LINE_STRIP, 0, count);
+			glDisableClientState(GL_VERTEX_ARRAY);
+			glEnable(GL_LIGHTING);
+		}
+
 		void RenderText(const std::string& text, const physx::PxVec2& location, 
 			const PxVec3& color, PxReal size)
 		{
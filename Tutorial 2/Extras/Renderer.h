@@ -2,6 +2,7 @@
 
 #include "PxPhysicsAPI.h"
 #include "GLFontRenderer.h"
+#include "TaskScheduler.h"
 #include <GL/glut.h>
 #include <string>
 
@@ -23,9 +24,19 @@ namespace VisualDebugger
 		///Render actors
 		void Render(PxActor** actors, const PxU32 numActors);
 
+		///Render actors from captured state: a global pose per actor and cloth particle ranges
+		///(particles of actor i start at particles[particle_offsets[i]])
+		void Render(PxActor** actors, const PxTransform* poses, const PxU32* particle_offsets, const PxVec3* particles, const PxU32 numActors);
+
+		///Use the worker pool to prepare the render list (0 = serial)
+		void SetTaskScheduler(PhysicsEngine::TaskScheduler* scheduler);
+
 		///Render debug information
 		void Render(const PxRenderBuffer& data, PxReal line_width=1.f);
 
+		///Render a polyline through the points in a single color
+		void RenderLines(const PxVec3* points, PxU32 count, const PxVec3& color, PxReal line_width=1.f);
+
 		///Render text
 		void RenderText(const std::string& text, const physx::PxVec2& location, 
 			const PxVec3& color, PxReal size);
@@ -0,0 +1,224 @@
+#include "TaskScheduler.h"
+
+namespace PhysicsEngine
+{
+	//worker identity of the calling thread
+	static thread_local TaskScheduler* tls_scheduler = 0;
+	static thread_local PxI32 tls_worker = -1;
+
+	///WorkStealingDeque methods
+
+	bool WorkStealingDeque::Push(PxBaseTask* task)
+	{
+		PxI64 b = bottom.load(std::memory_order_relaxed);
+		PxI64 t = top.load(std::memory_order_acquire);
+		if (b - t >= (PxI64)capacity)
+			return false;
+
+		tasks[b & (capacity - 1)].store(task, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_release);
+		return true;
+	}
+
+	PxBaseTask* WorkStealingDeque::Pop()
+	{
+		PxI64 b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b);
+		PxI64 t = top.load();
+
+		if (t > b)
+		{
+			//empty
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return 0;
+		}
+
+		PxBaseTask* task = tasks[b & (capacity - 1)].load(std::memory_order_relaxed);
+		if (t == b)
+		{
+			//last task, race against the thieves
+			if (!top.compare_exchange_strong(t, t + 1))
+				task = 0;
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+
+	PxBaseTask* WorkStealingDeque::Steal()
+	{
+		PxI64 t = top.load();
+		PxI64 b = bottom.load();
+		if (t >= b)
+			return 0;
+
+		PxBaseTask* task = tasks[t & (capacity - 1)].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1))
+			return 0;
+		return task;
+	}
+
+	///TaskScheduler methods
+
+	TaskScheduler::TaskScheduler(PxU32 worker_count)
+		: sleeping(0), pending(0), quit(false)
+	{
+		for (PxU32 i = 0; i < worker_count; i++)
+			deques.push_back(new WorkStealingDeque());
+
+		for (PxU32 i = 0; i < worker_count; i++)
+			threads.push_back(std::thread(&TaskScheduler::WorkerLoop, this, i));
+	}
+
+	TaskScheduler::~TaskScheduler()
+	{
+		quit = true;
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			wake_up.notify_all();
+		}
+
+		for (PxU32 i = 0; i < threads.size(); i++)
+			threads[i].join();
+
+		for (PxU32 i = 0; i < deques.size(); i++)
+			delete deques[i];
+	}
+
+	void TaskScheduler::submitTask(PxBaseTask& task)
+	{
+		//no workers, run in place like PxDefaultCpuDispatcher
+		if (!threads.size())
+		{
+			Execute(&task);
+			return;
+		}
+
+		//counted before it is published, a thief taking it at once must not take pending below zero
+		pending++;
+
+		//workers push to their own deque, everybody else to the shared queue
+		if ((tls_scheduler != this) || !deques[tls_worker]->Push(&task))
+		{
+			std::lock_guard<std::mutex> lock(shared_mutex);
+			shared_queue.push_back(&task);
+		}
+
+		if (sleeping > 0)
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			wake_up.notify_one();
+		}
+	}
+
+	PxU32 TaskScheduler::getWorkerCount() const
+	{
+		return (PxU32)threads.size();
+	}
+
+	PxBaseTask* TaskScheduler::FindTask(PxI32 index)
+	{
+		PxBaseTask* task = 0;
+
+		//own work first (LIFO, cache friendly)
+		if (index >= 0)
+			task = deques[index]->Pop();
+
+		//then the work submitted from outside the pool
+		if (!task)
+		{
+			std::lock_guard<std::mutex> lock(shared_mutex);
+			if (shared_queue.size())
+			{
+				task = shared_queue.front();
+				shared_queue.pop_front();
+			}
+		}
+
+		//finally steal from the other workers (FIFO end)
+		for (PxU32 i = 1; !task && (i <= deques.size()); i++)
+		{
+			PxU32 victim = (PxU32)(index + i) % (PxU32)deques.size();
+			if ((PxI32)victim != index)
+				task = deques[victim]->Steal();
+		}
+
+		if (task)
+			pending--;
+
+		return task;
+	}
+
+	void TaskScheduler::Execute(PxBaseTask* task)
+	{
+		//same protocol as PxDefaultCpuDispatcher
+		task->run();
+		task->release();
+	}
+
+	void TaskScheduler::WorkerLoop(PxU32 index)
+	{
+		tls_scheduler = this;
+		tls_worker = (PxI32)index;
+
+		while (!quit)
+		{
+			PxBaseTask* task = FindTask(tls_worker);
+			if (task)
+			{
+				Execute(task);
+				continue;
+			}
+
+			//nothing to do, sleep until new work is submitted
+			std::unique_lock<std::mutex> lock(sleep_mutex);
+			sleeping++;
+			wake_up.wait(lock, [this] { return (pending > 0) || quit; });
+			sleeping--;
+		}
+	}
+
+	void TaskScheduler::Wait(std::atomic<PxU32>& counter)
+	{
+		PxI32 index = (tls_scheduler == this) ? tls_worker : -1;
+
+		while (counter > 0)
+		{
+			PxBaseTask* task = FindTask(index);
+			if (task)
+				Execute(task);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	void TaskScheduler::ParallelFor(PxU32 count, PxU32 grain, const std::function<void(PxU32 begin, PxU32 end)>& body)
+	{
+		if (!grain)
+			grain = 1;
+
+		PxU32 ranges = (count + grain - 1) / grain;
+
+		//not worth the overhead
+		if ((ranges <= 1) || !threads.size())
+		{
+			if (count)
+				body(0, count);
+			return;
+		}
+
+		//the calling thread processes the first range itself
+		std::atomic<PxU32> counter(ranges - 1);
+		std::vector<Job> jobs(ranges - 1);
+		for (PxU32 i = 1; i < ranges; i++)
+		{
+			PxU32 begin = i * grain;
+			PxU32 end = PxMin(begin + grain, count);
+			jobs[i-1].Set([&body, begin, end] { body(begin, end); }, &counter);
+			submitTask(jobs[i-1]);
+		}
+
+		body(0, PxMin(grain, count));
+
+		Wait(counter);
+	}
+}
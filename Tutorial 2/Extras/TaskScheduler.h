@@ -0,0 +1,119 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Single-producer, multi-consumer work-stealing deque (Chase-Lev).
+	///Only the owning worker pushes and pops at the bottom, other threads steal from the top.
+	class WorkStealingDeque
+	{
+		static const PxU32 capacity = 4096;
+
+		std::atomic<PxI64> top;
+		std::atomic<PxI64> bottom;
+		std::atomic<PxBaseTask*> tasks[capacity];
+
+	public:
+		WorkStealingDeque() : top(0), bottom(0) {}
+
+		///Owner only: returns false if the deque is full
+		bool Push(PxBaseTask* task);
+
+		///Owner only: returns 0 if the deque is empty
+		PxBaseTask* Pop();
+
+		///Any thread: returns 0 if the deque is empty or the steal lost a race
+		PxBaseTask* Steal();
+	};
+
+	///A generic job that can be executed by the scheduler next to PhysX tasks
+	class Job : public PxBaseTask
+	{
+		std::function<void()> function;
+		std::atomic<PxU32>* counter;
+
+	public:
+		Job() : counter(0) {}
+
+		///Set the work and an optional counter decremented on completion
+		void Set(const std::function<void()>& _function, std::atomic<PxU32>* _counter=0)
+		{
+			function = _function;
+			counter = _counter;
+		}
+
+		virtual void run() { function(); }
+
+		virtual const char* getName() const { return "PhysicsEngine::Job"; }
+
+		//jobs have no dependencies
+		virtual void addReference() {}
+		virtual void removeReference() {}
+		virtual int32_t getReference() const { return 0; }
+
+		///signal completion to whoever waits on the counter
+		virtual void release()
+		{
+			if (counter)
+				counter->fetch_sub(1);
+		}
+	};
+
+	///Work-stealing thread pool shared by PhysX and the application.
+	///Each worker owns a lock-free deque, tasks submitted from outside the pool
+	///go to a shared queue and idle workers steal from each other.
+	class TaskScheduler : public PxCpuDispatcher
+	{
+		std::vector<std::thread> threads;
+		std::vector<WorkStealingDeque*> deques;
+
+		//tasks submitted by threads that are not workers (e.g. the render loop)
+		std::deque<PxBaseTask*> shared_queue;
+		std::mutex shared_mutex;
+
+		//sleeping workers
+		std::mutex sleep_mutex;
+		std::condition_variable wake_up;
+		std::atomic<PxU32> sleeping;
+		std::atomic<PxU32> pending;
+		std::atomic<bool> quit;
+
+		void WorkerLoop(PxU32 index);
+
+		PxBaseTask* FindTask(PxI32 index);
+
+		void Execute(PxBaseTask* task);
+
+	public:
+		///Create a pool with the given number of worker threads
+		TaskScheduler(PxU32 worker_count);
+
+		~TaskScheduler();
+
+		///PxCpuDispatcher: queue a PhysX (or any other) task
+		virtual void submitTask(PxBaseTask& task);
+
+		///PxCpuDispatcher: number of worker threads
+		virtual PxU32 getWorkerCount() const;
+
+		///Run tasks on the calling thread until the counter drops to zero
+		void Wait(std::atomic<PxU32>& counter);
+
+		///Split [0,count) into ranges of at most grain elements, run them on the pool and wait.
+		///The calling thread takes part in the work.
+		void ParallelFor(PxU32 count, PxU32 grain, const std::function<void(PxU32 begin, PxU32 end)>& body);
+
+		///Release the scheduler (same convention as PxDefaultCpuDispatcher)
+		void release() { delete this; }
+	};
+}
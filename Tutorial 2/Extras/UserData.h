@@ -1,14 +1,109 @@
 #pragma once
 
 #include "PxPhysicsAPI.h"
+#include <vector>
+
+//render attribute flags of a single shape
+struct RenderFlag
+{
+	enum Enum
+	{
+		HIGHLIGHT = (1 << 0) //selected actor, drawn brighter
+	};
+};
+
+///Per-shape render attributes stored as a structure of arrays and indexed by a stable shape id.
+///Released ids are recycled, so spawning and despawning shapes costs O(1) without heap allocations.
+class ShapeArena
+{
+	std::vector<physx::PxVec3> colors;
+	std::vector<physx::PxU32> flags;
+	std::vector<physx::PxU32> free_ids;
+
+public:
+	static const physx::PxU32 invalid_id = 0xffffffff;
+
+	///Get a new id with the given colour
+	physx::PxU32 Allocate(const physx::PxVec3& color)
+	{
+		if (free_ids.size())
+		{
+			physx::PxU32 id = free_ids.back();
+			free_ids.pop_back();
+			colors[id] = color;
+			flags[id] = 0;
+			return id;
+		}
+
+		colors.push_back(color);
+		flags.push_back(0);
+		return (physx::PxU32)colors.size() - 1;
+	}
+
+	///Return an id to the arena
+	void Free(physx::PxU32 id)
+	{
+		if (id < colors.size())
+			free_ids.push_back(id);
+	}
+
+	physx::PxVec3& Color(physx::PxU32 id) { return colors[id]; }
+
+	physx::PxU32& Flags(physx::PxU32 id) { return flags[id]; }
+
+	///Contiguous colour stream, Size() elements
+	const physx::PxVec3* Colors() const { return colors.size() ? &colors.front() : 0; }
+
+	///Contiguous flag stream, Size() elements
+	const physx::PxU32* Flags() const { return flags.size() ? &flags.front() : 0; }
+
+	physx::PxU32 Size() const { return (physx::PxU32)colors.size(); }
+};
+
+///The arena shared by all actors
+inline ShapeArena& GetShapeArena()
+{
+	static ShapeArena arena;
+	return arena;
+}
+
+///Shapes store their arena id in userData (no per-shape allocation)
+inline void SetShapeId(physx::PxShape* shape, physx::PxU32 id)
+{
+	shape->userData = (void*)((size_t)id + 1);
+}
+
+inline physx::PxU32 GetShapeId(const physx::PxShape* shape)
+{
+	return shape->userData ? (physx::PxU32)((size_t)shape->userData - 1) : ShapeArena::invalid_id;
+}
+
+///Rigid actors store a single id in userData for their shared shapes (see ShapeRegistry)
+inline void SetActorId(physx::PxRigidActor* actor, physx::PxU32 id)
+{
+	actor->userData = (id != ShapeArena::invalid_id) ? (void*)((size_t)id + 1) : 0;
+}
+
+inline physx::PxU32 GetActorId(const physx::PxRigidActor* actor)
+{
+	return actor->userData ? (physx::PxU32)((size_t)actor->userData - 1) : ShapeArena::invalid_id;
+}
+
+///Id of a shape as attached to the actor: its own id, or the actor id for shared shapes
+inline physx::PxU32 GetShapeId(const physx::PxShape* shape, const physx::PxRigidActor* actor)
+{
+	physx::PxU32 id = GetShapeId(shape);
+	return (id != ShapeArena::invalid_id) ? id : GetActorId(actor);
+}
 
 //add here any other structures that you want to pass from your simulation to the renderer
 class UserData
 {
 public:
-	physx::PxVec3* color;
-	physx::PxClothMeshDesc* cloth_mesh_desc;
+	physx::PxU32 color_id;
+	//shared by all cloths of the same fabric
+	const physx::PxClothMeshDesc* cloth_mesh_desc;
 
-	UserData(physx::PxVec3* _color=0, physx::PxClothMeshDesc* _cloth_mesh_desc=0) :
-		color(_color), cloth_mesh_desc(_cloth_mesh_desc) {}
-};
\ No newline at end of file
+	UserData(physx::PxU32 _color_id=ShapeArena::invalid_id, const physx::PxClothMeshDesc* _cloth_mesh_desc=0) :
+		color_id(_color_id), cloth_mesh_desc(_cloth_mesh_desc) {}
+};
@@ -0,0 +1,87 @@
+#include "FilterTable.h"
+#include "Exception.h"
+#include <cassert>
+
+namespace PhysicsEngine
+{
+	FilterTable::FilterTable()
+	{
+		for (PxU32 i = 0; i < max_groups; i++)
+		{
+			collide[i] = 0xffffffff;
+			notify[i] = 0;
+		}
+	}
+
+	void FilterTable::Collide(PxU32 group0, PxU32 group1, bool value)
+	{
+		if ((group0 >= max_groups) || (group1 >= max_groups))
+			throw new Exception("PhysicsEngine::FilterTable::Collide, The filter group is out of range.");
+
+		if (value)
+		{
+			collide[group0] |= (1u << group1);
+			collide[group1] |= (1u << group0);
+		}
+		else
+		{
+			collide[group0] &= ~(1u << group1);
+			collide[group1] &= ~(1u << group0);
+		}
+	}
+
+	void FilterTable::Notify(PxU32 group0, PxU32 group1, bool value)
+	{
+		if ((group0 >= max_groups) || (group1 >= max_groups))
+			throw new Exception("PhysicsEngine::FilterTable::Notify, The filter group is out of range.");
+
+		if (value)
+		{
+			notify[group0] |= (1u << group1);
+			notify[group1] |= (1u << group0);
+		}
+		else
+		{
+			notify[group0] &= ~(1u << group1);
+			notify[group1] &= ~(1u << group0);
+		}
+	}
+
+	PxFilterFlags TableFilterShader(PxFilterObjectAttributes attributes0, PxFilterData filterData0,
+		PxFilterObjectAttributes attributes1, PxFilterData filterData1,
+		PxPairFlags& pairFlags, const void* constantBlock, PxU32 constantBlockSize)
+	{
+		//let triggers through
+		if (PxFilterObjectIsTrigger(attributes0) || PxFilterObjectIsTrigger(attributes1))
+		{
+			pairFlags = PxPairFlag::eTRIGGER_DEFAULT;
+			return PxFilterFlags();
+		}
+
+		//swept contacts are only computed for bodies with eENABLE_CCD (see Scene::ContinuousCollision)
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+		pairFlags = PxPairFlag::eCONTACT_DEFAULT | PxPairFlag::eCCD_LINEAR;
+#else
+		pairFlags = PxPairFlag::eCONTACT_DEFAULT | PxPairFlag::eDETECT_CCD_CONTACT;
+#endif
+
+		//without a table everything collides
+		if (constantBlockSize < sizeof(FilterTable))
+			return PxFilterFlags();
+
+		const FilterTable& table = *(const FilterTable*)constantBlock;
+		PxU32 group0 = filterData0.word0;
+		PxU32 group1 = filterData1.word0;
+		//Actor::SetupFiltering rejects other groups
+		assert((group0 < FilterTable::max_groups) && (group1 < FilterTable::max_groups));
+
+		//killed pairs are not filtered again until Scene::SetFilterTable resets the filtering
+		if (!(table.collide[group0] & (1u << group1)))
+			return PxFilterFlag::eKILL;
+
+		if (table.notify[group0] & (1u << group1))
+			pairFlags |= PxPairFlag::eNOTIFY_TOUCH_FOUND | PxPairFlag::eNOTIFY_TOUCH_LOST;
+
+		return PxFilterFlags();
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Collision rules between up to 32 filter groups, passed to TableFilterShader as its constant block.
+	///The group of a shape is word0 of its simulation filter data (see Actor::SetupFiltering), 0 by default.
+	///All groups collide and no contacts are reported until the table says otherwise.
+	struct FilterTable
+	{
+		static const PxU32 max_groups = 32;
+
+		//bit j of collide[i]: groups i and j collide
+		PxU32 collide[max_groups];
+		//bit j of notify[i]: touches between groups i and j are reported to onContact
+		PxU32 notify[max_groups];
+
+		FilterTable();
+
+		///Enable or disable contacts between two groups (both directions)
+		void Collide(PxU32 group0, PxU32 group1, bool value);
+
+		///Enable or disable contact reports between two groups (both directions)
+		void Notify(PxU32 group0, PxU32 group1, bool value);
+	};
+
+	///Filter shader reading a FilterTable from the constant block: a pair is killed, or gets the default
+	///contact flags plus touch reports, after a single lookup. Triggers pass through as in PxDefaultSimulationFilterShader.
+	PxFilterFlags TableFilterShader(PxFilterObjectAttributes attributes0, PxFilterData filterData0,
+		PxFilterObjectAttributes attributes1, PxFilterData filterData1,
+		PxPairFlags& pairFlags, const void* constantBlock, PxU32 constantBlockSize);
+}
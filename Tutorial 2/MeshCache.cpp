@@ -0,0 +1,316 @@
+#include "MeshCache.h"
+#include "PhysicsEngine.h"
+#include <Windows.h>
+#include <stdio.h>
+
+namespace PhysicsEngine
+{
+	//bump when the key or the file format changes
+	static const PxU64 cache_version = 2;
+
+	//"PXMC", first word of every cache file
+	static const PxU32 cache_magic = 0x434d5850;
+
+	//64-bit FNV-1a
+	static const PxU64 fnv_basis = 14695981039346656037ULL;
+	static const PxU64 fnv_prime = 1099511628211ULL;
+
+	static PxU64 Hash(PxU64 hash, const void* data, size_t size)
+	{
+		const PxU8* bytes = (const PxU8*)data;
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * fnv_prime;
+		return hash;
+	}
+
+	template<class T>
+	static PxU64 Hash(PxU64 hash, const T& value)
+	{
+		return Hash(hash, &value, sizeof(T));
+	}
+
+	//strided data, element_size bytes of every element
+	static PxU64 Hash(PxU64 hash, const PxBoundedData& data, PxU32 element_size)
+	{
+		hash = Hash(hash, data.count);
+		const PxU8* element = (const PxU8*)data.data;
+		for (PxU32 i = 0; element && (i < data.count); i++, element += data.stride)
+			hash = Hash(hash, element, element_size);
+		return hash;
+	}
+
+	MeshCache::MeshCache(const std::string& _directory)
+		: enabled(true), memory_hits(0), disk_hits(0), misses(0)
+	{
+		Directory(_directory);
+	}
+
+	MeshCache::~MeshCache()
+	{
+		Clear();
+	}
+
+	void MeshCache::Directory(const std::string& value)
+	{
+		directory = value;
+		CreateDirectoryA(directory.c_str(), 0);
+	}
+
+	void MeshCache::Enable(bool value)
+	{
+		enabled = value;
+	}
+
+	void MeshCache::Clear()
+	{
+		for (std::unordered_map<PxU64, Entry*>::iterator it = entries.begin(); it != entries.end(); ++it)
+			Drop(it->second);
+		entries.clear();
+	}
+
+	PxU64 MeshCache::HashParams(PxU64 hash)
+	{
+		hash = Hash(hash, cache_version);
+		hash = Hash(hash, (PxU32)PX_PHYSICS_VERSION);
+#if PX_PHYSICS_VERSION >= 0x304000
+		const PxCookingParams& params = GetCooking()->getParams();
+		hash = Hash(hash, params.scale.length);
+		hash = Hash(hash, params.scale.speed);
+		hash = Hash(hash, params.areaTestEpsilon);
+		hash = Hash(hash, params.planeTolerance);
+		hash = Hash(hash, (PxU32)params.convexMeshCookingType);
+		hash = Hash(hash, params.suppressTriangleMeshRemapTable);
+		hash = Hash(hash, params.buildTriangleAdjacencies);
+		hash = Hash(hash, params.buildGPUData);
+		hash = Hash(hash, (PxU32)params.meshPreprocessParams);
+		hash = Hash(hash, params.meshWeldTolerance);
+		hash = Hash(hash, (PxU32)params.midphaseDesc.getType());
+		hash = Hash(hash, params.gaussMapLimit);
+#else
+		const PxCookingParams& params = GetCooking()->getParams();
+		hash = Hash(hash, params.scale.length);
+		hash = Hash(hash, params.scale.speed);
+		hash = Hash(hash, (PxU32)params.targetPlatform);
+		hash = Hash(hash, params.skinWidth);
+		hash = Hash(hash, params.suppressTriangleMeshRemapTable);
+		hash = Hash(hash, (PxU32)params.meshPreprocessParams);
+		hash = Hash(hash, (PxU32)params.meshCookingHint);
+		hash = Hash(hash, params.meshSizePerformanceTradeOff);
+#endif
+		return hash;
+	}
+
+	std::string MeshCache::FileName(PxU64 key, const char* extension)
+	{
+		char name[17];
+		sprintf_s(name, sizeof(name), "%016llx", (unsigned long long)key);
+		return directory + "\\" + name + extension;
+	}
+
+	MeshCache::Entry* MeshCache::Find(PxU64 key, const char* extension)
+	{
+		std::unordered_map<PxU64, Entry*>::iterator it = entries.find(key);
+		if (it != entries.end())
+		{
+			memory_hits++;
+			return it->second;
+		}
+
+		std::string filename = FileName(key, extension);
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (file == INVALID_HANDLE_VALUE)
+			return 0;
+
+		LARGE_INTEGER size;
+		HANDLE mapping = 0;
+		const PxU8* view = 0;
+		if (GetFileSizeEx(file, &size) && (size.QuadPart > (LONGLONG)sizeof(FileHeader)))
+		{
+			mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+			if (mapping)
+				view = (const PxU8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		}
+
+		//only a complete stream written by this version for this key reaches PhysX
+		const PxU8* stream = 0;
+		PxU64 stream_size = 0;
+		bool valid = false;
+		if (view)
+		{
+			const FileHeader* header = (const FileHeader*)view;
+			stream = view + sizeof(FileHeader);
+			stream_size = (PxU64)size.QuadPart - sizeof(FileHeader);
+			valid = (header->magic == cache_magic) && (header->version == (PxU32)cache_version) && (header->key == key) &&
+				(header->size == stream_size) && (header->hash == Hash(fnv_basis, stream, (size_t)stream_size));
+		}
+
+		if (!valid)
+		{
+			if (view)
+				UnmapViewOfFile(view);
+			if (mapping)
+				CloseHandle(mapping);
+			CloseHandle(file);
+			return 0;
+		}
+
+		Entry* entry = new Entry();
+		entry->file = file;
+		entry->mapping = mapping;
+		entry->file_view = view;
+		entry->view = stream;
+		entry->size = (PxU32)stream_size;
+		entries[key] = entry;
+		disk_hits++;
+		return entry;
+	}
+
+	MeshCache::Entry* MeshCache::Store(PxU64 key, const char* extension, const PxDefaultMemoryOutputStream& stream)
+	{
+		Entry* entry = new Entry();
+		entry->data.assign(stream.getData(), stream.getData() + stream.getSize());
+		entry->view = entry->data.data();
+		entry->size = (PxU32)entry->data.size();
+		entries[key] = entry;
+
+		FileHeader header = { cache_magic, (PxU32)cache_version, key, entry->size, Hash(fnv_basis, entry->view, entry->size) };
+
+		//write a temporary file (unique per process and thread) and move the complete file into place,
+		//a crash or a second instance never leaves a partial file under the final name.
+		//A failed write only costs a cook next time.
+		std::string filename = FileName(key, extension);
+		char suffix[32];
+		sprintf_s(suffix, sizeof(suffix), ".%lu.%lu.tmp", (unsigned long)GetCurrentProcessId(), (unsigned long)GetCurrentThreadId());
+		std::string temp_filename = filename + suffix;
+
+		FILE* out = 0;
+		if (!fopen_s(&out, temp_filename.c_str(), "wb") && out)
+		{
+			bool written = (fwrite(&header, sizeof(header), 1, out) == 1) && (fwrite(entry->view, 1, entry->size, out) == entry->size);
+			written = !fclose(out) && written;
+			if (!written || !MoveFileExA(temp_filename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+				DeleteFileA(temp_filename.c_str());
+		}
+		return entry;
+	}
+
+	void MeshCache::Drop(Entry* entry)
+	{
+		if (entry->mapping)
+		{
+			UnmapViewOfFile(entry->file_view);
+			CloseHandle(entry->mapping);
+			CloseHandle(entry->file);
+		}
+		delete entry;
+	}
+
+	void MeshCache::Drop(PxU64 key)
+	{
+		std::unordered_map<PxU64, Entry*>::iterator it = entries.find(key);
+		if (it != entries.end())
+		{
+			Drop(it->second);
+			entries.erase(it);
+		}
+	}
+
+	PxU64 MeshCache::Key(const PxConvexMeshDesc& mesh_desc)
+	{
+		PxU64 key = HashParams(fnv_basis);
+		key = Hash(key, "convex", 6);
+		key = Hash(key, mesh_desc.points, sizeof(PxVec3));
+		key = Hash(key, mesh_desc.indices, (mesh_desc.flags & PxConvexFlag::e16_BIT_INDICES) ? sizeof(PxU16) : sizeof(PxU32));
+		key = Hash(key, mesh_desc.polygons, sizeof(PxHullPolygon));
+		key = Hash(key, (PxU16)mesh_desc.flags);
+		key = Hash(key, mesh_desc.vertexLimit);
+		return key;
+	}
+
+	PxU64 MeshCache::Key(const PxTriangleMeshDesc& mesh_desc)
+	{
+		PxU64 key = HashParams(fnv_basis);
+		key = Hash(key, "triangle", 8);
+		key = Hash(key, mesh_desc.points, sizeof(PxVec3));
+		key = Hash(key, mesh_desc.triangles, (mesh_desc.flags & PxMeshFlag::e16_BIT_INDICES) ? 3 * sizeof(PxU16) : 3 * sizeof(PxU32));
+		if (mesh_desc.materialIndices.data)
+		{
+			const PxU8* index = (const PxU8*)mesh_desc.materialIndices.data;
+			for (PxU32 i = 0; i < mesh_desc.triangles.count; i++, index += mesh_desc.materialIndices.stride)
+				key = Hash(key, index, sizeof(PxMaterialTableIndex));
+		}
+		key = Hash(key, (PxU16)mesh_desc.flags);
+		return key;
+	}
+
+	PxConvexMesh* MeshCache::CreateConvexMesh(const PxConvexMeshDesc& mesh_desc)
+	{
+		return CreateConvexMesh(mesh_desc, Key(mesh_desc));
+	}
+
+	PxConvexMesh* MeshCache::CreateConvexMesh(const PxConvexMeshDesc& mesh_desc, PxU64 key)
+	{
+		if (enabled)
+		{
+			Entry* entry = Find(key, ".convex");
+			if (entry)
+			{
+				PxDefaultMemoryInputData input((PxU8*)entry->view, entry->size);
+				PxConvexMesh* mesh = GetPhysics()->createConvexMesh(input);
+				if (mesh)
+					return mesh;
+				//stale or damaged file: cook again
+				Drop(key);
+			}
+		}
+
+		misses++;
+		PxDefaultMemoryOutputStream stream;
+		if (!GetCooking()->cookConvexMesh(mesh_desc, stream))
+			throw new Exception("MeshCache::CreateConvexMesh, cooking failed.");
+
+		if (enabled)
+			Store(key, ".convex", stream);
+
+		PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+		return GetPhysics()->createConvexMesh(input);
+	}
+
+	PxTriangleMesh* MeshCache::CreateTriangleMesh(const PxTriangleMeshDesc& mesh_desc)
+	{
+		return CreateTriangleMesh(mesh_desc, Key(mesh_desc));
+	}
+
+	PxTriangleMesh* MeshCache::CreateTriangleMesh(const PxTriangleMeshDesc& mesh_desc, PxU64 key)
+	{
+		if (enabled)
+		{
+			Entry* entry = Find(key, ".trimesh");
+			if (entry)
+			{
+				PxDefaultMemoryInputData input((PxU8*)entry->view, entry->size);
+				PxTriangleMesh* mesh = GetPhysics()->createTriangleMesh(input);
+				if (mesh)
+					return mesh;
+				Drop(key);
+			}
+		}
+
+		misses++;
+		PxDefaultMemoryOutputStream stream;
+		if (!GetCooking()->cookTriangleMesh(mesh_desc, stream))
+			throw new Exception("MeshCache::CreateTriangleMesh, cooking failed.");
+
+		if (enabled)
+			Store(key, ".trimesh", stream);
+
+		PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+		return GetPhysics()->createTriangleMesh(input);
+	}
+
+	MeshCache& GetMeshCache()
+	{
+		static MeshCache cache;
+		return cache;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Content-addressed cache of cooked meshes.
+	///The key is a hash of the mesh description and the cooking parameters, cooked streams are kept
+	///in memory and in a directory on disk (one file per mesh), so later runs and later spawns skip cooking.
+	///Files are memory-mapped and handed to PhysX without a copy. Each file starts with a header
+	///(magic, version, key, stream size and hash) that is checked before the stream is deserialized,
+	///files are written under a temporary name and moved into place, so a damaged file is cooked again.
+	class MeshCache
+	{
+		//a cooked stream, owned (just cooked) or a mapped cache file
+		struct Entry
+		{
+			std::vector<PxU8> data;
+			void* file;
+			void* mapping;
+			//start of the mapped file, the stream follows the header
+			const void* file_view;
+			const PxU8* view;
+			PxU32 size;
+
+			Entry() : file(0), mapping(0), file_view(0), view(0), size(0) {}
+		};
+
+		//start of a cache file
+		struct FileHeader
+		{
+			PxU32 magic;
+			PxU32 version;
+			PxU64 key;
+			PxU64 size;
+			PxU64 hash;
+		};
+
+		std::string directory;
+		bool enabled;
+		std::unordered_map<PxU64, Entry*> entries;
+
+		PxU32 memory_hits;
+		PxU32 disk_hits;
+		PxU32 misses;
+
+		static PxU64 HashParams(PxU64 hash);
+
+		std::string FileName(PxU64 key, const char* extension);
+
+		//cached stream for the key, 0 if there is none in memory or on disk
+		Entry* Find(PxU64 key, const char* extension);
+
+		//store a freshly cooked stream
+		Entry* Store(PxU64 key, const char* extension, const PxDefaultMemoryOutputStream& stream);
+
+		void Drop(Entry* entry);
+
+		void Drop(PxU64 key);
+
+	public:
+		MeshCache(const std::string& directory="mesh_cache");
+
+		~MeshCache();
+
+		///Content key of a convex mesh (description and cooking parameters)
+		static PxU64 Key(const PxConvexMeshDesc& mesh_desc);
+
+		///Content key of a triangle mesh (description and cooking parameters)
+		static PxU64 Key(const PxTriangleMeshDesc& mesh_desc);
+
+		///Cook or load a convex mesh
+		PxConvexMesh* CreateConvexMesh(const PxConvexMeshDesc& mesh_desc);
+
+		///Same with a key computed by Key
+		PxConvexMesh* CreateConvexMesh(const PxConvexMeshDesc& mesh_desc, PxU64 key);
+
+		///Cook or load a triangle mesh
+		PxTriangleMesh* CreateTriangleMesh(const PxTriangleMeshDesc& mesh_desc);
+
+		///Same with a key computed by Key
+		PxTriangleMesh* CreateTriangleMesh(const PxTriangleMeshDesc& mesh_desc, PxU64 key);
+
+		///Set the cache directory, it is created if it does not exist
+		void Directory(const std::string& value);
+
+		///Enable or disable the cache (always cook when disabled)
+		void Enable(bool value);
+
+		///Release the in-memory streams and mappings (files stay on disk)
+		void Clear();
+
+		PxU32 MemoryHits() const { return memory_hits; }
+		PxU32 DiskHits() const { return disk_hits; }
+		PxU32 Misses() const { return misses; }
+	};
+
+	///The cache used by ConvexMesh and TriangleMesh
+	MeshCache& GetMeshCache();
+}
@@ -0,0 +1,85 @@
+#include "MeshLibrary.h"
+#include "MeshCache.h"
+
+namespace PhysicsEngine
+{
+	PxBase* MeshLibrary::Find(PxU64 key)
+	{
+		if (!enabled)
+			return 0;
+
+		std::unordered_map<PxU64, PxBase*>::iterator it = shared_meshes.find(key);
+		if (it == shared_meshes.end())
+			return 0;
+		entries[it->second].users++;
+		return it->second;
+	}
+
+	void MeshLibrary::Insert(PxU64 key, PxBase* mesh)
+	{
+		Entry entry = { key, 1, enabled };
+		entries[mesh] = entry;
+		if (enabled)
+			shared_meshes[key] = mesh;
+	}
+
+	PxConvexMesh* MeshLibrary::AcquireConvexMesh(const PxConvexMeshDesc& mesh_desc)
+	{
+		PxU64 key = MeshCache::Key(mesh_desc);
+		PxBase* mesh = Find(key);
+		if (mesh)
+			return (PxConvexMesh*)mesh;
+
+		PxConvexMesh* new_mesh = GetMeshCache().CreateConvexMesh(mesh_desc, key);
+		Insert(key, new_mesh);
+		return new_mesh;
+	}
+
+	PxTriangleMesh* MeshLibrary::AcquireTriangleMesh(const PxTriangleMeshDesc& mesh_desc)
+	{
+		PxU64 key = MeshCache::Key(mesh_desc);
+		PxBase* mesh = Find(key);
+		if (mesh)
+			return (PxTriangleMesh*)mesh;
+
+		PxTriangleMesh* new_mesh = GetMeshCache().CreateTriangleMesh(mesh_desc, key);
+		Insert(key, new_mesh);
+		return new_mesh;
+	}
+
+	void MeshLibrary::Release(PxBase* mesh)
+	{
+		//unknown meshes: already cleared with the SDK
+		std::unordered_map<PxBase*, Entry>::iterator it = entries.find(mesh);
+		if (it == entries.end())
+			return;
+
+		if (--it->second.users == 0)
+		{
+			//the shapes of the last actor still hold their own references
+			if (it->second.shared)
+				shared_meshes.erase(it->second.key);
+			entries.erase(it);
+			mesh->release();
+		}
+	}
+
+	void MeshLibrary::Clear()
+	{
+		for (std::unordered_map<PxBase*, Entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+			it->first->release();
+		entries.clear();
+		shared_meshes.clear();
+	}
+
+	void MeshLibrary::Enable(bool value)
+	{
+		enabled = value;
+	}
+
+	MeshLibrary& GetMeshLibrary()
+	{
+		static MeshLibrary library;
+		return library;
+	}
+}
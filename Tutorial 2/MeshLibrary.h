@@ -0,0 +1,55 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <unordered_map>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Shared meshes: each distinct mesh (same MeshCache key) is created once and handed out to all actors.
+	///The library keeps one PhysX reference per mesh and counts the actors using it,
+	///the reference is released when the last actor gives the mesh back.
+	class MeshLibrary
+	{
+		struct Entry
+		{
+			PxU64 key;
+			PxU32 users;
+			bool shared;
+		};
+
+		//meshes handed out and their users, shared meshes by key
+		std::unordered_map<PxBase*, Entry> entries;
+		std::unordered_map<PxU64, PxBase*> shared_meshes;
+		bool enabled;
+
+		PxBase* Find(PxU64 key);
+
+		void Insert(PxU64 key, PxBase* mesh);
+
+	public:
+		MeshLibrary() : enabled(true) {}
+
+		///Get the shared convex mesh for the description, created (or loaded from the cache) on first use
+		PxConvexMesh* AcquireConvexMesh(const PxConvexMeshDesc& mesh_desc);
+
+		///Get the shared triangle mesh for the description, created (or loaded from the cache) on first use
+		PxTriangleMesh* AcquireTriangleMesh(const PxTriangleMeshDesc& mesh_desc);
+
+		///Give back a mesh returned by one of the Acquire methods
+		void Release(PxBase* mesh);
+
+		///Release the library references of all meshes (shapes keep theirs)
+		void Clear();
+
+		///Share meshes (enabled) or create a new mesh for every Acquire
+		void Enable(bool value);
+
+		///Number of meshes in use
+		PxU32 Size() const { return (PxU32)entries.size(); }
+	};
+
+	///The library used by ConvexMesh and TriangleMesh
+	MeshLibrary& GetMeshLibrary();
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "BasicActors.h"
+#include "EventQueue.h"
 #include <iostream>
 #include <iomanip>
 #include <stdlib.h>
@@ -44,13 +45,33 @@ namespace PhysicsEngine
 	};
 
 
+	///Filter groups of the rugby scene, indices into the scene FilterTable
+	struct FilterGroup
+	{
+		enum Enum
+		{
+			DEFAULT,
+			PITCH,
+			GOAL,
+			FURNITURE,
+			BALL,
+			BRICK,
+			CANNONBALL,
+			CONFETTI,
+			CLOTH
+			//add more if you need (up to 32)
+		};
+	};
+
 	class MySimulationEventCallback : public PxSimulationEventCallback
 	{
 	public:
 		//an example variable that will be checked in the main simulation loop
 		bool trigger;
+		//events for the main loop, the callbacks run inside fetchResults and must not block
+		SimulationEventQueue* events;
 
-		MySimulationEventCallback() : trigger(false) {}
+		MySimulationEventCallback(SimulationEventQueue* _events=0) : trigger(false), events(_events) {}
 
 		///Method called when the contact with the trigger object is detected.
 		virtual void onTrigger(PxTriggerPair* pairs, PxU32 count)
@@ -64,14 +85,15 @@ namespace PhysicsEngine
 					//check if eNOTIFY_TOUCH_FOUND trigger
 					if (pairs[i].status & PxPairFlag::eNOTIFY_TOUCH_FOUND)
 					{
-						//cerr << "onTrigger::eNOTIFY_TOUCH_FOUND" << endl;
-						cerr << "Well done, you scored" << endl;
+						if (events)
+							events->Push(SimulationEvent(SimulationEvent::TRIGGER_FOUND, pairs[i].triggerActor, pairs[i].otherActor));
 						trigger = true;
 					}
 					//check if eNOTIFY_TOUCH_LOST trigger
 					if (pairs[i].status & PxPairFlag::eNOTIFY_TOUCH_LOST)
 					{
-						//cerr << "onTrigger::eNOTIFY_TOUCH_LOST" << endl;
+						if (events)
+							events->Push(SimulationEvent(SimulationEvent::TRIGGER_LOST, pairs[i].triggerActor, pairs[i].otherActor));
 						trigger = false;
 					}
 				}
@@ -98,22 +120,18 @@ namespace PhysicsEngine
 		///Method called when the contact by the filter shader is detected.
 		virtual void onContact(const PxContactPairHeader& pairHeader, const PxContactPair* pairs, PxU32 nbPairs)
 		{
-			cerr << "Contact found between " << pairHeader.actors[0]->getName() << " " << pairHeader.actors[1]->getName() << endl;
+			if (!events)
+				return;
 
 			//check all pairs
 			for (PxU32 i = 0; i < nbPairs; i++)
 			{
 				//check eNOTIFY_TOUCH_FOUND
 				if (pairs[i].events & PxPairFlag::eNOTIFY_TOUCH_FOUND)
-				{
-					cerr << "onContact::eNOTIFY_TOUCH_FOUND" << endl;
-					
-				}
+					events->Push(SimulationEvent(SimulationEvent::CONTACT_FOUND, pairHeader.actors[0], pairHeader.actors[1]));
 				//check eNOTIFY_TOUCH_LOST
 				if (pairs[i].events & PxPairFlag::eNOTIFY_TOUCH_LOST)
-				{
-					cerr << "onContact::eNOTIFY_TOUCH_LOST" << endl;
-				}
+					events->Push(SimulationEvent(SimulationEvent::CONTACT_LOST, pairHeader.actors[0], pairHeader.actors[1]));
 			}
 		}
 	};
@@ -124,10 +142,11 @@ namespace PhysicsEngine
 	{
 
 		//actors
-		Plane* plane;
+		//plane and ball are used after initialisation and are also bound to loaded actors (see CustomLoad)
+		Actor* plane;
 		Box* box;
 		RugbyGoalPost* gPost;
-		RugbyBall* ball;
+		Actor* ball;
 		FieldLines* fieldlines;
 		OuterLines* outerlines;
 		Castle* castleTB;
@@ -144,31 +163,187 @@ namespace PhysicsEngine
 		std::vector<Box*> boxesSpawned;
 		std::vector<Sphere*> spheresSpawned;
 		std::vector<CannonBall*>cballsSpawned;
+		//despawned actors are parked here and reused by the next spawn
+		ActorPool<Box> boxPool{ this };
+		ActorPool<Sphere> spherePool{ this };
+		ActorPool<CannonBall> cballPool{ this };
+		//insertion list of the celebration spheres, kept so spawning does not allocate
+		static const PxU32 celebrationSpheres = 100;
+		std::vector<Actor*> celebrationBatch = std::vector<Actor*>(celebrationSpheres);
 
 		//triggers
 		triggerBox* tBox;
 		bool boxSpawned;
-		MySimulationEventCallback* callback;
+		//contact and trigger events of the last steps, drained by CustomUpdate
+		SimulationEventQueue events;
+		MySimulationEventCallback callback{ &events };
+		//optional text log of the events, written on its own thread
+		EventLog* eventLog = 0;
+		//events dropped by a full queue that were already reported
+		PxU32 droppedEvents = 0;
 
 		//extra variables
 		bool blockerSpawned = false;
 		bool celebrationSpawned = false;
 
+		//celebration flags created at init and kept out of the scene (not simulated or captured),
+		//scoring only adds them; the scene owns them while they are in it
+		bool prewarmFlags = true;
+		Cloth* celebrationFlags[2] = { 0, 0 };
+		bool celebrationFlagsAdded = false;
+		PxTransform celebrationPoses[2] = { PxTransform(PxVec3(-26.0f, 20.f, -108.f)), PxTransform(PxVec3(20.f, 20.f, -108.f)) };
+		PxVec3 celebrationColors[2] = { PxVec3(1, 0, 0), PxVec3(0, 0, 1) };
+
+		//collision shapes of the rugby ball
+		RugbyBall::Representation ballRepresentation = RugbyBall::SPHERE_COMPOUND;
+		//drag, lift and tumbling of the ball in flight
+		bool ballAerodynamics = true;
+		//group the pitch furniture and the seesaw into broadphase aggregates
+		bool aggregateActors = true;
+
+		//kick prediction: aim of the next kick (degrees, m/s), the spread of candidate kicks around it
+		//and the predicted flight of the aim
+		TrajectoryPredictor predictor;
+		TrajectoryPredictor::Batch kickBatch;
+		PxReal kickYaw = 0.f, kickPitch = 35.f, kickSpeed = 25.f;
+		static const PxU32 kickSpread = 8;
+		std::vector<PxVec3> kickArc;
+		PxU32 kickArcSize = 0;
+		TrajectoryPredictor::Outcome kickOutcome = TrajectoryPredictor::SHORT;
+		PxReal kickChance = 0.f;
+
 
 		
 		//materials
 		// https://www.engineeringtoolbox.com/friction-coefficients-d_778.html
 		// https://hypertextbook.com/facts/2006/restitution.shtml
-		PxMaterial* ballMaterial = CreateMaterial(1.16f, 0.65f, 0.828f); //rugby ball
-		PxMaterial* grassMaterial = CreateMaterial(0.9f, 0.5f, 0.3f); //grass
-		PxMaterial* postMaterial = CreateMaterial(0.65f, 0.42f, 0.597f); // steel post
-		PxMaterial* castleMaterial = CreateMaterial(0.5f, 0.4f, 0.8f); //stone castle
-		PxMaterial* cannonballMaterial = CreateMaterial(0.65f, 0.42f, 0.0f); //cannon ball material (steel based) 
-		PxMaterial* glassMaterial = CreateMaterial(0.9f,0.4f,0.1f); //glass material
-		PxMaterial* iceMaterial = CreateMaterial(0.1f, 0.02f, 0.2f); //ice material
+		//materials are registered once and shared by every scene instance
+		PxMaterial* ballMaterial = CreateMaterial("ball", 1.16f, 0.65f, 0.828f); //rugby ball
+		PxMaterial* grassMaterial = CreateMaterial("grass", 0.9f, 0.5f, 0.3f); //grass
+		PxMaterial* postMaterial = CreateMaterial("post", 0.65f, 0.42f, 0.597f); // steel post
+		PxMaterial* castleMaterial = CreateMaterial("castle", 0.5f, 0.4f, 0.8f); //stone castle
+		PxMaterial* cannonballMaterial = CreateMaterial("cannonball", 0.65f, 0.42f, 0.0f); //cannon ball material (steel based) 
+		PxMaterial* glassMaterial = CreateMaterial("glass", 0.9f,0.4f,0.1f); //glass material
+		PxMaterial* iceMaterial = CreateMaterial("ice", 0.1f, 0.02f, 0.2f); //ice material
+
+		//pitch surfaces: grass, glass, ice
+		enum PlaneSurface { SURFACE_GRASS, SURFACE_GLASS, SURFACE_ICE, SURFACE_COUNT };
+		PxU32 planeMaterials[SURFACE_COUNT] = { GetMaterialIndex("grass"), GetMaterialIndex("glass"), GetMaterialIndex("ice") };
+		PxVec3 planeColors[SURFACE_COUNT] = { PxVec3(0, 0.3f, 0), PxVec3(0.9f, 1.0f, 0.9f), PxVec3(0.2f, 0.0f, 1.0f) };
 		
 	public:
 		///A custom scene class
+		MyScene(PxU32 worker_count=-1) : Scene(worker_count)
+		{
+			//hard kicks tunnel through the crossbar without CCD
+			ContinuousCollision(CCDMode::ADAPTIVE);
+			SetFilterTable(filterTable());
+		}
+
+		virtual ~MyScene()
+		{
+			//the last step pushes events from fetchResults, finish it before the queue goes
+			if (px_scene)
+			{
+				EndStep();
+				px_scene->setSimulationEventCallback(0);
+			}
+			delete eventLog;
+			releaseCelebrationFlags();
+		}
+
+		///Create the celebration flags at init (set before Init or Load)
+		void PrewarmFlags(bool value) { prewarmFlags = value; }
+
+		///Collision shapes of the rugby ball (set before Init)
+		void BallRepresentation(RugbyBall::Representation value) { ballRepresentation = value; }
+
+		///Air forces on the rugby ball (set before Init or Load)
+		void BallAerodynamics(bool value) { ballAerodynamics = value; }
+
+		///Group the static pitch furniture and the seesaw into aggregates (set before Init)
+		void AggregateActors(bool value) { aggregateActors = value; }
+
+		///Write contact and trigger events to cerr from a background thread
+		void LogEvents(bool value)
+		{
+			if (value && !eventLog)
+				eventLog = new EventLog(cerr);
+			else if (!value && eventLog)
+			{
+				delete eventLog;
+				eventLog = 0;
+			}
+		}
+
+		///Get event logging
+		bool LogEvents() { return eventLog != 0; }
+
+		///Change the aim of the next kick: yaw to the right and pitch in degrees, speed in m/s
+		void AimKick(PxReal yaw, PxReal pitch, PxReal speed)
+		{
+			kickYaw = PxClamp(kickYaw + yaw, -45.f, 45.f);
+			kickPitch = PxClamp(kickPitch + pitch, 5.f, 80.f);
+			kickSpeed = PxClamp(kickSpeed + speed, 5.f, 60.f);
+		}
+
+		///Kick the ball along the aim (call between steps)
+		void Kick()
+		{
+			PxRigidDynamic* px_ball = ball->Get()->is<PxRigidDynamic>();
+			px_ball->setLinearVelocity(kickVelocity(kickYaw, kickPitch, kickSpeed));
+			px_ball->setAngularVelocity(PxVec3(0));
+			px_ball->wakeUp();
+		}
+
+		///Predict the aimed kick and the spread of kicks around it from the current ball position,
+		///only reads the ball pose (call between steps)
+		void PredictKick()
+		{
+			PxVec3 position = ball->Get()->is<PxRigidDynamic>()->getGlobalPose().p;
+
+			//the aim is the last candidate, the others miss it by up to 3 degrees and 3 m/s
+			kickBatch.Resize(kickSpread * kickSpread + 1);
+			for (PxU32 i = 0; i < kickSpread; i++)
+			{
+				for (PxU32 j = 0; j < kickSpread; j++)
+				{
+					PxReal yaw = kickYaw + 6.f * ((i + .5f) / kickSpread - .5f);
+					PxReal speed = kickSpeed + 6.f * ((j + .5f) / kickSpread - .5f);
+					kickBatch.Set(i * kickSpread + j, position, kickVelocity(yaw, kickPitch, speed));
+				}
+			}
+			PxVec3 velocity = kickVelocity(kickYaw, kickPitch, kickSpeed);
+			kickBatch.Set(kickSpread * kickSpread, position, velocity);
+
+			predictor.Evaluate(kickBatch);
+
+			PxU32 goals = 0;
+			for (PxU32 i = 0; i < kickSpread * kickSpread; i++)
+			{
+				if (kickBatch.outcome[i] == TrajectoryPredictor::GOAL)
+					goals++;
+			}
+			kickChance = (PxReal)goals / (kickSpread * kickSpread);
+			kickOutcome = (TrajectoryPredictor::Outcome)kickBatch.outcome[kickSpread * kickSpread];
+			kickArcSize = predictor.Arc(position, velocity, kickArc.data(), (PxU32)kickArc.size());
+		}
+
+		///Points of the predicted flight of the aimed kick
+		const PxVec3* KickArc() const { return kickArc.data(); }
+
+		///Number of points of the predicted flight
+		PxU32 KickArcSize() const { return kickArcSize; }
+
+		///Predicted outcome of the aimed kick
+		TrajectoryPredictor::Outcome KickOutcome() const { return kickOutcome; }
+
+		///Share of the kicks around the aim that convert
+		PxReal KickChance() const { return kickChance; }
+
+		///Aim of the next kick: yaw, pitch (degrees) and speed (m/s)
+		PxVec3 KickAim() const { return PxVec3(kickYaw, kickPitch, kickSpeed); }
+
 		void SetVisualisation()
 		{
 			px_scene->setVisualizationParameter(PxVisualizationParameter::eSCALE, 1.0f);
@@ -188,8 +363,10 @@ namespace PhysicsEngine
 
 			//grass
 			plane = new Plane();
+			plane->Name("plane");
 			plane->Color(PxVec3(0,0.3f,0));
 			plane->Material(grassMaterial);
+			plane->SetupFiltering(FilterGroup::PITCH);
 			Add(plane);
 
 
@@ -202,58 +379,82 @@ namespace PhysicsEngine
 			//pyramid = new Pyramid();
 			//Add(pyramid);
 
+			//static pitch furniture: a single broadphase entry (the plane is unbounded and stays out)
+			Aggregate* furniture = 0;
+			if (aggregateActors)
+			{
+				furniture = new Aggregate(6);
+				Add(furniture);
+			}
+
 			//trigger box
 			tBox = new triggerBox();
 			tBox->Color(PxVec3(0.6f, 0.3f, 1));
 			tBox->SetTrigger(true);
 
-			callback = new MySimulationEventCallback();
+			callback.trigger = false;
 			PxShape* shape = tBox->GetShape();
 			shape->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);
-			px_scene->setSimulationEventCallback(callback);
+			px_scene->setSimulationEventCallback(&callback);
 
-			Add(tBox);
+			Add(tBox, furniture);
 
 			//goal post
 			gPost = new RugbyGoalPost();
 			gPost->Material(postMaterial);
-			Add(gPost);
+			gPost->SetupFiltering(FilterGroup::GOAL);
+			Add(gPost, furniture);
 
 
 			//rugby ball
-			ball = new RugbyBall();
+			ball = new RugbyBall(PxTransform(0, 4, 26), 0.7f, 0.6f, ballRepresentation);
+			ball->Name("ball");
 			ball->Color(PxVec3(0.4f, 0.2f, 0));
 			ball->Get()->is<PxRigidDynamic>()->setGlobalPose(PxTransform(PxVec3(0, 6, -34.5f)));
 			ball->Material(ballMaterial);
+			ball->SetupFiltering(FilterGroup::BALL);
 			Add(ball);
 
 
 			//field lines
 			fieldlines = new FieldLines();
 			fieldlines->Material(grassMaterial);
-			Add(fieldlines);
+			fieldlines->SetupFiltering(FilterGroup::PITCH);
+			Add(fieldlines, furniture);
 
 			outerlines = new OuterLines();
 			outerlines->Material(grassMaterial);
-			Add(outerlines);
+			outerlines->SetupFiltering(FilterGroup::PITCH);
+			Add(outerlines, furniture);
 
 			//castle
 			castleTB = new Castle();
 			castleTB->Color(PxVec3(0.4f, 0.4f, 0.4f));
 			castleTB->Material(castleMaterial);
-			Add(castleTB);
+			castleTB->SetupFiltering(FilterGroup::FURNITURE);
+			Add(castleTB, furniture);
+
 
+			//see saw, the board rests on the bases so they collide with each other
+			Aggregate* seesaw = 0;
+			if (aggregateActors)
+			{
+				seesaw = new Aggregate(3, true);
+				Add(seesaw);
+			}
 
-			//see saw
 			ssBase = new SeesawBase();
 			SeesawBase* ssBase2;
 			ssBase2 = new SeesawBase();
-			Add(ssBase);
-			Add(ssBase2);
+			ssBase->SetupFiltering(FilterGroup::FURNITURE);
+			ssBase2->SetupFiltering(FilterGroup::FURNITURE);
+			Add(ssBase, seesaw);
+			Add(ssBase2, seesaw);
 
 
 			ss = new Seesaw();
-			Add(ss);
+			ss->SetupFiltering(FilterGroup::FURNITURE);
+			Add(ss, seesaw);
 
 			/*sphere = new Sphere();
 			Add(sphere);*/
@@ -271,7 +472,14 @@ namespace PhysicsEngine
 			//cloth pole
 			pole = new flagPole;
 			pole->Color(PxVec3(0.4f, 0.4f, 0.4f));
-			Add(pole);
+			pole->SetupFiltering(FilterGroup::FURNITURE);
+			Add(pole, furniture);
+
+			prewarmCelebrationFlags();
+
+			setupAerodynamics();
+
+			setupPredictor(gPost->Goal());
 
 			//joint to hold see saw in place after kicks
 			DistanceJoint* joint = new DistanceJoint(ssBase, PxTransform(PxVec3(0.0f, 5.0f, 0.0f)), ss, PxTransform(PxVec3(0.0f, 3.0f, 0.0f)));
@@ -281,55 +489,230 @@ namespace PhysicsEngine
 
 		}
 
+		//Custom setup of a scene loaded from a file (see Scene::Save)
+		virtual void CustomLoad()
+		{
+			SetVisualisation();
+
+			GetMaterial()->setDynamicFriction(.2f);
+
+			plane = Find("plane");
+			ball = Find("ball");
+			if (!plane || !ball)
+				throw new Exception("MyScene::CustomLoad, The file does not contain the rugby scene.");
+
+			callback.trigger = false;
+			px_scene->setSimulationEventCallback(&callback);
+
+			prewarmCelebrationFlags();
+
+			setupAerodynamics();
+
+			//a loaded goal post is a plain static actor, assume it was not moved
+			setupPredictor(TrajectoryPredictor::Goal());
+		}
+
+		//air forces on the rugby ball, a loaded ball has the default size
+		void setupAerodynamics()
+		{
+			if (!ballAerodynamics)
+				return;
+
+			//the ball is far lighter for its size than a real one and the pitch is doubled,
+			//thinner air gives it roughly the deceleration of a real kick
+			Aerodynamics::Parameters parameters;
+			parameters.air_density = .05f;
+			GetAerodynamics().SetParameters(parameters);
+
+			RugbyBall* rugbyBall = dynamic_cast<RugbyBall*>(ball);
+			GetAerodynamics().Add(ball->Get()->is<PxRigidDynamic>(), rugbyBall ? rugbyBall->Radius() : .7f,
+				rugbyBall ? rugbyBall->HalfLength() : 1.15f);
+		}
+
+		//kick prediction against the goal, with the drag of the ball when it has air forces
+		void setupPredictor(const TrajectoryPredictor::Goal& goal)
+		{
+			predictor.SetGoal(goal);
+
+			RugbyBall* rugbyBall = dynamic_cast<RugbyBall*>(ball);
+			PxReal radius = rugbyBall ? rugbyBall->Radius() : .7f;
+			PxReal half_length = rugbyBall ? rugbyBall->HalfLength() : 1.15f;
+
+			TrajectoryPredictor::Parameters parameters;
+			parameters.gravity = -px_scene->getGravity().y;
+			parameters.ball_radius = radius;
+			if (ballAerodynamics)
+			{
+				//drag of the ball flying half end on and half side on: |F| = rho/2 |v|^2 (Ca Aa + Cs As)/2
+				const Aerodynamics::Parameters& air = GetAerodynamics().GetParameters();
+				PxReal drag_area = .5f * (air.drag_axial * PxPi * radius * radius + air.drag_side * PxPi * radius * half_length);
+				parameters.drag = .5f * air.air_density * drag_area / ball->Get()->is<PxRigidDynamic>()->getMass();
+			}
+			predictor.SetParameters(parameters);
+			kickArc.resize((PxU32)(parameters.max_time / parameters.time_step) + 1);
+		}
+
+		//velocity of a kick towards the goal (-z), yaw to the right and pitch in degrees
+		static PxVec3 kickVelocity(PxReal yaw, PxReal pitch, PxReal speed)
+		{
+			PxReal y = yaw * PxPi / 180.f, p = pitch * PxPi / 180.f;
+			return PxVec3(PxSin(y) * PxCos(p), PxSin(p), -PxCos(y) * PxCos(p)) * speed;
+		}
+
+		//Custom reset function, the spawned actors go back to their pools
+		virtual void CustomReset()
+		{
+			despawnBricks();
+			despawnCBalls();
+			despawncannonBalls();
+			boxSpawned = false;
+			blockerSpawned = false;
+			celebrationSpawned = false;
+			callback.trigger = false;
+			planeSurface(SURFACE_GRASS);
+			parkCelebrationFlags();
+		}
+
 		//Custom udpate function
 		virtual void CustomUpdate() 
 		{
+			drainEvents();
+
 			//Trigger
-			if (callback->trigger && !celebrationSpawned) {
+			if (callback.trigger && !celebrationSpawned) {
 				spawnCelebrationFlags();
 				celebrationSpawned = true;
 			}
 		}
 
 
+		//MBP regions: the castle (walls at +-70 x +-120) and the celebration drop zone behind it
+		virtual PxBounds3 WorldBounds() {
+			PxBounds3 bounds = Scene::WorldBounds();
+			bounds.include(PxBounds3(PxVec3(-10.f, 0.f, -210.f), PxVec3(10.f, 0.f, -190.f)));
+			return bounds;
+		}
+
+		//collision rules between the groups: the celebration spheres pass through each other and the flags,
+		//touches of the ball and the goal are reported
+		static FilterTable filterTable() {
+			FilterTable table;
+			table.Collide(FilterGroup::CONFETTI, FilterGroup::CONFETTI, false);
+			table.Collide(FilterGroup::CONFETTI, FilterGroup::CLOTH, false);
+			table.Notify(FilterGroup::BALL, FilterGroup::GOAL, true);
+			return table;
+		}
+
+		//handle the events of the last steps, text output goes to the log thread
+		void drainEvents() {
+			SimulationEvent event;
+			while (events.Pop(event)) {
+				if (event.type == SimulationEvent::TRIGGER_FOUND)
+					cerr << "Well done, you scored" << endl;
+				if (eventLog)
+					eventLog->Push(event);
+			}
+
+			//a full queue loses events, make it visible
+			PxU32 dropped = events.Dropped();
+			if (dropped != droppedEvents) {
+				if (eventLog)
+					eventLog->Lost(dropped - droppedEvents);
+				else
+					cerr << (dropped - droppedEvents) << " contact and trigger events dropped, the queue was full" << endl;
+				droppedEvents = dropped;
+			}
+		}
+
 		virtual void spawnBox() {
 			if (boxSpawned == false) {
-				box = new Box();
+				box = boxPool.Spawn(PxTransform(PxVec3(0, 85, -60.3f)), FilterGroup::BRICK);
 				box->Color(PxVec3(1.0f,0.5f,0.0f));
-				box->Get()->is<PxRigidDynamic>()->setGlobalPose(PxTransform(PxVec3(0, 85, -60.3f)));
 				box->Get()->is<PxRigidDynamic>()->setMass(30);
-				Add(box);
 				boxesSpawned.push_back(box);
 			}
 		}
 
 		virtual void despawnBricks() {
 			for (auto box : boxesSpawned) {
-				box->Get()->is<PxActor>()->release();
+				boxPool.Release(box);
 			}
 			boxesSpawned.clear();
 		}
 
 		virtual void spawnBall() {
-			//rugby ball
-			ball->Get()->is<PxActor>()->release();
-			ball = new RugbyBall();
-			ball->Color(PxVec3(0.4f, 0.2f, 0));
-			ball->Get()->is<PxRigidDynamic>()->setGlobalPose(PxTransform(PxVec3(0, 5, -40.0f)));
-			ball->Material(ballMaterial);
-			Add(ball);
+			//rugby ball, moved back to the kicking tee instead of re-created
+			PxRigidDynamic* px_ball = ball->Get()->is<PxRigidDynamic>();
+			px_ball->setGlobalPose(PxTransform(PxVec3(0, 5, -40.0f)));
+			px_ball->setLinearVelocity(PxVec3(0));
+			px_ball->setAngularVelocity(PxVec3(0));
+			px_ball->clearForce();
+			px_ball->clearTorque();
+			px_ball->wakeUp();
 		}
 
-		virtual void spawnCelebrationFlags() {
-			//cloth left top
-			Cloth* cloth_left_top = new Cloth(PxTransform(PxVec3(-26.0f, 20.f, -108.f)), PxVec2(6.f, 6.f), 40, 40);
-			cloth_left_top->Color(PxVec3(1, 0, 0));
-			Add(cloth_left_top);
+		//create the flags parked out of sight, the fabric is shared with every later flag
+		void prewarmCelebrationFlags() {
+			//flags of a previous Init, parked by CustomReset
+			releaseCelebrationFlags();
+			for (PxU32 i = 0; i < 2; i++)
+			{
+				if (!prewarmFlags)
+					continue;
+				celebrationFlags[i] = new Cloth(celebrationPoses[i], PxVec2(6.f, 6.f), 40, 40);
+				celebrationFlags[i]->Color(celebrationColors[i]);
+				celebrationFlags[i]->SetupFiltering(FilterGroup::CLOTH);
+			}
+		}
 
-			//cloth right top
-			Cloth* cloth_right_top = new Cloth(PxTransform(PxVec3(20.f, 20.f, -108.f)), PxVec2(6.f, 6.f), 40, 40);
-			cloth_right_top->Color(PxVec3(0, 0, 1));
-			Add(cloth_right_top);
+		//take the shown flags out of the scene again, they are kept for the next celebration
+		void parkCelebrationFlags() {
+			if (!celebrationFlagsAdded)
+				return;
+			for (PxU32 i = 0; i < 2; i++)
+			{
+				if (celebrationFlags[i])
+					Detach(celebrationFlags[i]);
+			}
+			celebrationFlagsAdded = false;
+		}
+
+		//delete the parked flags, flags in the scene are deleted with it
+		void releaseCelebrationFlags() {
+			for (PxU32 i = 0; i < 2; i++)
+			{
+				if (!celebrationFlags[i] || celebrationFlagsAdded)
+					continue;
+				PxActor* actor = celebrationFlags[i]->Get();
+				delete celebrationFlags[i];
+				actor->release();
+			}
+			celebrationFlags[0] = celebrationFlags[1] = 0;
+			celebrationFlagsAdded = false;
+		}
+
+		virtual void spawnCelebrationFlags() {
+			for (PxU32 i = 0; i < 2; i++)
+			{
+				if (celebrationFlags[i])
+				{
+					//left top and right top, prewarmed
+					if (celebrationFlagsAdded)
+						continue;
+					celebrationFlags[i]->Reset(celebrationPoses[i]);
+					Add(celebrationFlags[i]);
+				}
+				else
+				{
+					//cloth left top, cloth right top
+					Cloth* cloth = new Cloth(celebrationPoses[i], PxVec2(6.f, 6.f), 40, 40);
+					cloth->Color(celebrationColors[i]);
+					cloth->SetupFiltering(FilterGroup::CLOTH);
+					Add(cloth);
+				}
+			}
+			if (celebrationFlags[0] || celebrationFlags[1])
+				celebrationFlagsAdded = true;
 
 			// Check if the celebration has already been triggered
 			if (celebrationSpawned) {
@@ -337,44 +720,40 @@ namespace PhysicsEngine
 			}
 			celebrationSpawned = true;
 
-			// Generate random positions and colors for the spheres
+			// Spawn the spheres at random positions with random colors, inserted into the scene in one batch
 			const PxVec3 spawn(0.0f, 50.0f, -200.0f);
-			std::vector<PxVec3> positions(100);
-			std::vector<PxVec3> colors(100);
-			for (int i = 0; i < 100; i++) {
+			for (PxU32 i = 0; i < celebrationSpheres; i++) {
 				float x = ((float)rand() / RAND_MAX);
 				float y = ((float)rand() / RAND_MAX);
 				float z = ((float)rand() / RAND_MAX);
-				PxTransform transform(PxVec3(x, y, z));
-
-				positions[i] = spawn + PxVec3(x, y, z);
-				colors[i] = PxVec3((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX);
-			}
+				PxVec3 color((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX);
 
-			// Spawn the spheres
-			for (int i = 0; i < 100; i++) {
-				Sphere* sphere = new Sphere(PxTransform(positions[i]));
-				sphere->Color(colors[i]);
-				Add(sphere);
+				Sphere* sphere = spherePool.Get(PxTransform(spawn + PxVec3(x, y, z)), FilterGroup::CONFETTI);
+				sphere->Color(color);
+				celebrationBatch[i] = sphere;
 				spheresSpawned.push_back(sphere);
 			}
+			AddBatch(celebrationBatch);
+			for (PxU32 i = 0; i < celebrationSpheres; i++)
+				celebrationBatch[i]->Get()->is<PxRigidDynamic>()->wakeUp();
 		}
 
 		virtual void despawnCBalls() {
 			for (auto sphere : spheresSpawned) {
-				sphere->Get()->is<PxActor>()->release();
+				spherePool.Release(sphere);
 			}
 			spheresSpawned.clear();
 		}
 
 		void toggleBlocker() {
 			if (blockerSpawned ) {
-				blocker->Get()->is<PxActor>()->release();
+				Remove(blocker);
 				blockerSpawned = false;
 			}
 			else {
 				blocker = new blockerBox();
 				blocker->Color(PxVec3(1, 0, 0));
+				blocker->SetupFiltering(FilterGroup::FURNITURE);
 				Add(blocker);
 				blockerSpawned = true;
 			}
@@ -382,33 +761,35 @@ namespace PhysicsEngine
 
 
 		virtual void spawnCannonBallBlocker() {
-			cannonBall = new CannonBall();
+			cannonBall = cballPool.Spawn(PxTransform(0, 20, -70), FilterGroup::CANNONBALL);
 			cannonBall->Color(PxVec3(0, 0, 0));
 			cannonBall->Material(cannonballMaterial);
-			Add(cannonBall);
 			cballsSpawned.push_back(cannonBall);
 		}
 
 		virtual void despawncannonBalls() {
 			for (auto cannonBall : cballsSpawned) {
-				cannonBall->Get()->is<PxActor>()->release();
+				cballPool.Release(cannonBall);
 			}
 			cballsSpawned.clear();
 		}
 
+		//swap the pitch material and colour
+		void planeSurface(PlaneSurface surface) {
+			plane->Color(planeColors[surface]);
+			plane->Material(GetMaterial(planeMaterials[surface]));
+		}
+
 		virtual void planeMatGlass() {
-			plane->Color(PxVec3(0.9f, 1.0f, 0.9f));
-			plane->Material(glassMaterial);
+			planeSurface(SURFACE_GLASS);
 		}
 
 		virtual void planeMatIce() {
-			plane->Color(PxVec3(0.2f, 0.0f, 1.0f));
-			plane->Material(iceMaterial);
+			planeSurface(SURFACE_ICE);
 		}
 
 		virtual void planeMatGrass() {
-			plane->Color(PxVec3(0, 0.3f, 0));
-			plane->Material(grassMaterial);
+			planeSurface(SURFACE_GRASS);
 		}
 	};
 }
@@ -1,14 +1,18 @@
 #include "PhysicsEngine.h"
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <thread>
+#include <unordered_map>
 
 namespace PhysicsEngine
 {
 	using namespace physx;
 	using namespace std;
 
-	//default error and allocator callbacks
+	//default error callback and tracking allocator
 	PxDefaultErrorCallback gDefaultErrorCallback;
-	PxDefaultAllocator gDefaultAllocatorCallback;
+	TrackingAllocator gAllocatorCallback;
 
 	//PhysX objects
 	PxFoundation* foundation = 0;
@@ -20,21 +24,41 @@ namespace PhysicsEngine
 	PxPhysics* physics = 0;
 	PxCooking* cooking = 0;
 
+	//material registry: every material created through CreateMaterial, indexed in creation order
+	struct MaterialKey
+	{
+		PxReal sf, df, cr;
+
+		bool operator<(const MaterialKey& other) const
+		{
+			if (sf != other.sf) return sf < other.sf;
+			if (df != other.df) return df < other.df;
+			return cr < other.cr;
+		}
+	};
+
+	std::vector<PxMaterial*> material_table;
+	std::map<MaterialKey, PxU32> material_keys;
+	std::unordered_map<std::string, PxU32> material_names;
+
 	///PhysX functions
 	void PxInit()
 	{
 		//foundation
 		if (!foundation) {
 #if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
-			foundation = PxCreateFoundation(PX_PHYSICS_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+			foundation = PxCreateFoundation(PX_PHYSICS_VERSION, gAllocatorCallback, gDefaultErrorCallback);
 #else
-			foundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+			foundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gAllocatorCallback, gDefaultErrorCallback);
 #endif
 		}
 
 		if (!foundation)
 			throw new Exception("PhysicsEngine::PxInit, Could not create the PhysX SDK foundation.");
 
+		//type names for the per-name allocation counters (off by default in release builds)
+		foundation->setReportAllocationNames(true);
+
 		//visual debugger
 		if (!pvd) {
 #if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
@@ -70,6 +94,11 @@ namespace PhysicsEngine
 
 	void PxRelease()
 	{
+		//shared shapes, meshes and fabrics still referenced by actors go with the SDK
+		GetShapeRegistry().Clear();
+		GetMeshLibrary().Clear();
+		GetClothFabricPool().Clear();
+
 		if (cooking)
 			cooking->release();
 		if (physics)
@@ -78,6 +107,24 @@ namespace PhysicsEngine
 			pvd->release();
 		if (foundation)
 			foundation->release();
+
+		//materials are gone with the SDK
+		material_table.clear();
+		material_keys.clear();
+		material_names.clear();
+
+		//anything still allocated at this point has leaked
+		DumpAllocationStats(cerr, 20);
+	}
+
+	TrackingAllocator& GetAllocator()
+	{
+		return gAllocatorCallback;
+	}
+
+	void DumpAllocationStats(std::ostream& out, PxU32 max_names)
+	{
+		gAllocatorCallback.Dump(out, max_names);
 	}
 
 	PxPhysics* GetPhysics() 
@@ -92,16 +139,75 @@ namespace PhysicsEngine
 
 	PxMaterial* GetMaterial(PxU32 index)
 	{
-		std::vector<PxMaterial*> materials(physics->getNbMaterials());
-		if (index < physics->getMaterials((PxMaterial**)&materials.front(), (PxU32)materials.size()))
-			return materials[index];
+		if (index < material_table.size())
+			return material_table[index];
 		else
 			return 0;
 	}
 
 	PxMaterial* CreateMaterial(PxReal sf, PxReal df, PxReal cr) 
 	{
-		return physics->createMaterial(sf, df, cr);
+		return GetMaterial(CreateMaterialIndex(sf, df, cr));
+	}
+
+	PxMaterial* CreateMaterial(const std::string& name, PxReal sf, PxReal df, PxReal cr)
+	{
+		PxU32 index = CreateMaterialIndex(sf, df, cr);
+		material_names[name] = index;
+		return GetMaterial(index);
+	}
+
+	PxU32 CreateMaterialIndex(PxReal sf, PxReal df, PxReal cr)
+	{
+		MaterialKey key = { sf, df, cr };
+		std::map<MaterialKey, PxU32>::iterator it = material_keys.find(key);
+
+		//reuse only if the material has not been modified since it was registered
+		if (it != material_keys.end())
+		{
+			PxMaterial* material = material_table[it->second];
+			if ((material->getStaticFriction() == sf) && (material->getDynamicFriction() == df) && (material->getRestitution() == cr))
+				return it->second;
+		}
+
+		PxMaterial* material = physics->createMaterial(sf, df, cr);
+		if (!material)
+			throw new Exception("PhysicsEngine::CreateMaterial, Could not create the material.");
+
+		PxU32 index = (PxU32)material_table.size();
+		material_table.push_back(material);
+		material_keys[key] = index;
+		return index;
+	}
+
+	PxU32 GetMaterialIndex(const std::string& name)
+	{
+		std::unordered_map<std::string, PxU32>::iterator it = material_names.find(name);
+		if (it != material_names.end())
+			return it->second;
+		else
+			return -1;
+	}
+
+	PxMaterial* FindMaterial(const std::string& name)
+	{
+		return GetMaterial(GetMaterialIndex(name));
+	}
+
+	PxU32 GetMaterialCount()
+	{
+		return (PxU32)material_table.size();
+	}
+
+	//serial ids of the registered materials, above the ids used for scene objects
+	static const PxSerialObjectId material_id_base = PxSerialObjectId(1) << 32;
+
+	PxCollection* CreateMaterialCollection()
+	{
+		PxCollection* materials = PxCreateCollection();
+		for (PxU32 i = 0; i < material_table.size(); i++)
+			materials->add(*material_table[i], material_id_base + i);
+		return materials;
 	}
 
 	///Actor methods
@@ -112,32 +218,101 @@ namespace PhysicsEngine
 	}
 	void Actor::SetTrigger(bool value, PxU32 shape_index)
 	{
-		std::vector<PxShape*> shape_list = GetShapes(shape_index);
-		for (PxU32 i = 0; i < shape_list.size(); i++)
+		PxShape* const* shapes = ShapeArray();
+		for (PxU32 i = 0; i < shape_count; i++)
 		{
-			shape_list[i]->setFlag(PxShapeFlag::eSIMULATION_SHAPE, !value);
-			shape_list[i]->setFlag(PxShapeFlag::eTRIGGER_SHAPE, value);
+			if ((shape_index != -1) && (shape_index != i))
+				continue;
+
+			//shared shapes are swapped for the shared shape with the new flags
+			if (!shapes[i]->isExclusive())
+			{
+				PxShapeFlags flags = shapes[i]->getFlags();
+				flags.clear(PxShapeFlag::eSIMULATION_SHAPE);
+				flags.clear(PxShapeFlag::eTRIGGER_SHAPE);
+				flags.set(value ? PxShapeFlag::eTRIGGER_SHAPE : PxShapeFlag::eSIMULATION_SHAPE);
+				PxMaterial* material;
+				shapes[i]->getMaterials(&material, 1);
+				ReplaceShape(i, GetShapeRegistry().Get(shapes[i]->getGeometry().any(), material, shapes[i]->getLocalPose(), flags,
+					shapes[i]->getSimulationFilterData()));
+				continue;
+			}
+
+			shapes[i]->setFlag(PxShapeFlag::eSIMULATION_SHAPE, !value);
+			shapes[i]->setFlag(PxShapeFlag::eTRIGGER_SHAPE, value);
+		}
+	}
+	void Actor::SetupFiltering(PxU32 group, PxU32 shape_index)
+	{
+		if (group >= FilterTable::max_groups)
+			throw new Exception("PhysicsEngine::Actor::SetupFiltering, The filter group is out of range.");
+
+		PxFilterData filter_data(group, 0, 0, 0);
+
+		//cloth has no shapes, its filter data applies to all its collisions
+		if (!shape_count)
+		{
+			if (PxCloth* cloth = actor->is<PxCloth>())
+				cloth->setSimulationFilterData(filter_data);
+			return;
+		}
+
+		PxShape* const* shapes = ShapeArray();
+		for (PxU32 i = 0; i < shape_count; i++)
+		{
+			if ((shape_index != -1) && (shape_index != i))
+				continue;
+
+			//nothing to do for recycled actors (see ActorPool)
+			if (shapes[i]->getSimulationFilterData().word0 == group)
+				continue;
+
+			//shared shapes are swapped for the shared shape with the new filter data
+			if (!shapes[i]->isExclusive())
+			{
+				PxMaterial* material;
+				shapes[i]->getMaterials(&material, 1);
+				ReplaceShape(i, GetShapeRegistry().Get(shapes[i]->getGeometry().any(), material, shapes[i]->getLocalPose(), shapes[i]->getFlags(),
+					filter_data));
+				continue;
+			}
+
+			shapes[i]->setSimulationFilterData(filter_data);
 		}
 	}
 	void Actor::Color(PxVec3 new_color, PxU32 shape_index)
 	{
-		//change color of all shapes
-		if (shape_index == -1)
+		ShapeArena& arena = GetShapeArena();
+
+		//actors without shapes have a single colour
+		if (!shape_count)
 		{
-			for (unsigned int i = 0; i < colors.size(); i++)
-				colors[i] = new_color;
+			if (color_id != ShapeArena::invalid_id)
+				arena.Color(color_id) = new_color;
+			return;
 		}
-		//or only the selected one
-		else if (shape_index < colors.size())
+
+		//change color of all shapes or only the selected one
+		PxShape* const* shapes = ShapeArray();
+		for (PxU32 i = 0; i < shape_count; i++)
 		{
-			colors[shape_index] = new_color;
+			if ((shape_index == -1) || (shape_index == i))
+			{
+				PxU32 id = GetShapeId(shapes[i]);
+				arena.Color((id != ShapeArena::invalid_id) ? id : color_id) = new_color;
+			}
 		}
 	}
 
 	const PxVec3* Actor::Color(PxU32 shape_indx)
 	{
-		if (shape_indx < colors.size())
-			return &colors[shape_indx];
+		if (shape_indx < shape_count)
+		{
+			PxU32 id = GetShapeId(ShapeArray()[shape_indx]);
+			return &GetShapeArena().Color((id != ShapeArena::invalid_id) ? id : color_id);
+		}
+		else if (!shape_count && (color_id != ShapeArena::invalid_id))
+			return &GetShapeArena().Color(color_id);
 		else 
 			return 0;			
 	}
@@ -145,35 +320,100 @@ namespace PhysicsEngine
 
 	void Actor::Material(PxMaterial* new_material, PxU32 shape_index)
 	{
-		std::vector<PxShape*> shape_list = GetShapes(shape_index);
-		for (PxU32 i = 0; i < shape_list.size(); i++)
+		PxShape* const* shapes = ShapeArray();
+		for (PxU32 i = 0; i < shape_count; i++)
 		{
-			std::vector<PxMaterial*> materials(shape_list[i]->getNbMaterials());
-			for (unsigned int j = 0; j < materials.size(); j++)
-				materials[j] = new_material;
-			shape_list[i]->setMaterials(materials.data(), (PxU16)materials.size());
+			if ((shape_index != -1) && (shape_index != i))
+				continue;
+
+			//shared shapes are swapped for the shared shape with the new material
+			if (!shapes[i]->isExclusive())
+			{
+				ReplaceShape(i, GetShapeRegistry().Get(shapes[i]->getGeometry().any(), new_material, shapes[i]->getLocalPose(), shapes[i]->getFlags(),
+					shapes[i]->getSimulationFilterData()));
+				continue;
+			}
+
+			//single material shapes (all but height fields and meshes) need no temporary array
+			PxU16 count = shapes[i]->getNbMaterials();
+			if (count == 1)
+			{
+				shapes[i]->setMaterials(&new_material, 1);
+				continue;
+			}
+
+			std::vector<PxMaterial*> materials(count, new_material);
+			shapes[i]->setMaterials(materials.data(), count);
 		}
 	}
 
+	void Actor::AddShape(PxShape* shape)
+	{
+		if (shape_count < inline_shapes)
+		{
+			shape_buffer[shape_count] = shape;
+		}
+		else
+		{
+			//move to the heap once the inline buffer is full
+			if (shape_count == inline_shapes)
+				shape_overflow.assign(shape_buffer, shape_buffer + inline_shapes);
+			shape_overflow.push_back(shape);
+		}
+		shape_count++;
+	}
+
+	PxShape* const* Actor::ShapeArray() const
+	{
+		return (shape_count <= inline_shapes) ? shape_buffer : &shape_overflow.front();
+	}
+
+	void Actor::AttachShape(PxShape* shape)
+	{
+		PxRigidActor* rigid_actor = (PxRigidActor*)actor;
+		rigid_actor->attachShape(*shape);
+		AddShape(shape);
+
+		//one set of render attributes for all shared shapes of the actor
+		if (color_id == ShapeArena::invalid_id)
+		{
+			color_id = GetShapeArena().Allocate(default_color);
+			SetActorId(rigid_actor, color_id);
+		}
+	}
+
+	void Actor::ReplaceShape(PxU32 index, PxShape* shape)
+	{
+		PxShape*& cached = (shape_count <= inline_shapes) ? shape_buffer[index] : shape_overflow[index];
+		if (cached == shape)
+			return;
+
+		PxRigidActor* rigid_actor = (PxRigidActor*)actor;
+		rigid_actor->attachShape(*shape);
+		rigid_actor->detachShape(*cached);
+		cached = shape;
+	}
+
+	PxU32 Actor::ShapeCount() const
+	{
+		return shape_count;
+	}
+
 	PxShape* Actor::GetShape(PxU32 index)
 	{
-		std::vector<PxShape*> shapes(((PxRigidActor*)actor)->getNbShapes());
-		if (index < ((PxRigidActor*)actor)->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size()))
-			return shapes[index];
+		if (index < shape_count)
+			return ShapeArray()[index];
 		else
 			return 0;
 	}
 
 	std::vector<PxShape*> Actor::GetShapes(PxU32 index)
 	{
-		std::vector<PxShape*> shapes(((PxRigidActor*)actor)->getNbShapes());
-		((PxRigidActor*)actor)->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
+		PxShape* const* shapes = ShapeArray();
 		if (index == -1)
-			return shapes;
-		else if (index < shapes.size())
-		{
+			return std::vector<PxShape*>(shapes, shapes + shape_count);
+		else if (index < shape_count)
 			return std::vector<PxShape*>(1, shapes[index]);
-		}
 		else
 			return std::vector<PxShape*>();
 	}
@@ -197,19 +437,25 @@ namespace PhysicsEngine
 
 	DynamicActor::~DynamicActor()
 	{
-		for (unsigned int i = 0; i < colors.size(); i++)
-			delete (UserData*)GetShape(i)->userData;
+		PxShape* const* shapes = ShapeArray();
+		for (unsigned int i = 0; i < shape_count; i++)
+			GetShapeArena().Free(GetShapeId(shapes[i]));
+		GetShapeArena().Free(color_id);
 	}
 
 	void DynamicActor::CreateShape(const PxGeometry& geometry, PxReal density)
 	{
 		PxShape* shape = ((PxRigidDynamic*)actor)->createShape(geometry,*GetMaterial());
 		PxRigidBodyExt::updateMassAndInertia(*(PxRigidDynamic*)actor, density);
-		colors.push_back(default_color);
-		//pass the color pointers to the renderer
-		shape->userData = new UserData();
-		for (unsigned int i = 0; i < colors.size(); i++)
-			((UserData*)GetShape(i)->userData)->color = &colors[i];
+		AddShape(shape);
+		//pass the render attributes to the renderer
+		SetShapeId(shape, GetShapeArena().Allocate(default_color));
+	}
+
+	void DynamicActor::CreateSharedShape(const PxGeometry& geometry, PxReal density, const PxTransform& local_pose)
+	{
+		AttachShape(GetShapeRegistry().Get(geometry, GetMaterial(), local_pose));
+		PxRigidBodyExt::updateMassAndInertia(*(PxRigidDynamic*)actor, density);
 	}
 
 	void DynamicActor::SetKinematic(bool value, PxU32 index)
@@ -229,33 +475,307 @@ namespace PhysicsEngine
 
 	StaticActor::~StaticActor()
 	{
-		for (unsigned int i = 0; i < colors.size(); i++)
-			delete (UserData*)GetShape(i)->userData;
+		PxShape* const* shapes = ShapeArray();
+		for (unsigned int i = 0; i < shape_count; i++)
+			GetShapeArena().Free(GetShapeId(shapes[i]));
+		GetShapeArena().Free(color_id);
 	}
 
 	void StaticActor::CreateShape(const PxGeometry& geometry, PxReal density)
 	{
 		PxShape* shape = ((PxRigidStatic*)actor)->createShape(geometry,*GetMaterial());
-		colors.push_back(default_color);
-		//pass the color pointers to the renderer
-		shape->userData = new UserData();
-		for (unsigned int i = 0; i < colors.size(); i++)
-			((UserData*)GetShape(i)->userData)->color = &colors[i];
+		AddShape(shape);
+		//pass the render attributes to the renderer
+		SetShapeId(shape, GetShapeArena().Allocate(default_color));
+	}
+
+	void StaticActor::CreateSharedShape(const PxGeometry& geometry, const PxTransform& local_pose)
+	{
+		AttachShape(GetShapeRegistry().Get(geometry, GetMaterial(), local_pose));
+	}
+
+	///LoadedActor methods
+
+	LoadedActor::LoadedActor(PxActor* _actor) : Actor()
+	{
+		actor = _actor;
+		if (actor->getName())
+			name = actor->getName();
+
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+		PxRigidActor* rigid_actor = actor->isRigidActor();
+#else
+		PxRigidActor* rigid_actor = actor->is<PxRigidActor>();
+#endif
+		if (rigid_actor)
+		{
+			std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
+			if (shapes.size())
+				rigid_actor->getShapes(&shapes.front(), (PxU32)shapes.size());
+			for (PxU32 i = 0; i < shapes.size(); i++)
+				AddShape(shapes[i]);
+			color_id = GetActorId(rigid_actor);
+		}
+	}
+
+	LoadedActor::~LoadedActor()
+	{
+		PxShape* const* shapes = ShapeArray();
+		for (unsigned int i = 0; i < shape_count; i++)
+			GetShapeArena().Free(GetShapeId(shapes[i]));
+		GetShapeArena().Free(color_id);
+	}
+
+	///Aggregate methods
+
+	Aggregate::Aggregate(PxU32 max_actors, bool self_collision)
+	{
+		aggregate = GetPhysics()->createAggregate(max_actors, self_collision);
+		if (!aggregate)
+			throw new Exception("PhysicsEngine::Aggregate::Aggregate, Could not create the aggregate.");
+	}
+
+	Aggregate::~Aggregate()
+	{
+		aggregate->release();
+	}
+
+	void Aggregate::Add(Actor* actor)
+	{
+		if (!aggregate->addActor(*actor->Get()))
+			throw new Exception("PhysicsEngine::Aggregate::Add, Could not add the actor (aggregate full or actor already in a scene).");
+	}
+
+	PxAggregate* Aggregate::Get()
+	{
+		return aggregate;
+	}
+
+	///PoseSnapshot methods
+	void PoseSnapshot::Capture(PxScene* scene, TaskScheduler* scheduler)
+	{
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+		physx::PxActorTypeSelectionFlags selection_flag = PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eRIGID_STATIC |
+			PxActorTypeSelectionFlag::eCLOTH;
+#else
+		physx::PxActorTypeFlags selection_flag = PxActorTypeFlag::eRIGID_DYNAMIC | PxActorTypeFlag::eRIGID_STATIC |
+			PxActorTypeFlag::eCLOTH;
+#endif
+		actors.resize(scene->getNbActors(selection_flag));
+		if (actors.size())
+			scene->getActors(selection_flag, &actors.front(), (PxU32)actors.size());
+		poses.resize(actors.size());
+
+		//reserve particle ranges for the cloths
+		particle_offsets.resize(actors.size()+1);
+		PxU32 nb_particles = 0;
+		for (PxU32 i = 0; i < actors.size(); i++)
+		{
+			particle_offsets[i] = nb_particles;
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			if (actors[i]->isCloth())
+#else
+			if (actors[i]->is<PxCloth>())
+#endif
+				nb_particles += ((PxCloth*)actors[i])->getNbParticles();
+		}
+		particle_offsets[actors.size()] = nb_particles;
+		particles.resize(nb_particles);
+
+		std::function<void(PxU32, PxU32)> copy = [this](PxU32 begin, PxU32 end)
+		{
+			for (PxU32 i = begin; i < end; i++)
+			{
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+				if (actors[i]->isCloth())
+#else
+				if (actors[i]->is<PxCloth>())
+#endif
+				{
+					PxCloth* cloth = (PxCloth*)actors[i];
+					poses[i] = cloth->getGlobalPose();
+					PxClothParticleData* particle_data = cloth->lockParticleData();
+					if (!particle_data)
+						continue;
+					for (PxU32 j = particle_offsets[i]; j < particle_offsets[i+1]; j++)
+						particles[j] = particle_data->particles[j - particle_offsets[i]].pos;
+					particle_data->unlock();
+				}
+				else
+					poses[i] = ((PxRigidActor*)actors[i])->getGlobalPose();
+			}
+		};
+
+		if (scheduler)
+			scheduler->ParallelFor((PxU32)actors.size(), 64, copy);
+		else
+			copy(0, (PxU32)actors.size());
+	}
+
+	void PoseSnapshot::Interpolate(const PoseSnapshot& previous, PxReal alpha, std::vector<PxTransform>& result) const
+	{
+		result = poses;
+
+		for (PxU32 i = 0; i < result.size(); i++)
+		{
+			if ((i >= previous.actors.size()) || (previous.actors[i] != actors[i]))
+				continue;
+
+			const PxTransform& p0 = previous.poses[i];
+			const PxTransform& p1 = poses[i];
+
+			//normalised lerp along the shortest arc
+			PxQuat q1 = (p0.q.dot(p1.q) < 0.f) ? -p1.q : p1.q;
+			result[i] = PxTransform(p0.p + (p1.p - p0.p) * alpha, (p0.q * (1.f - alpha) + q1 * alpha).getNormalized());
+		}
+	}
+
+	///SceneState methods
+
+	void SceneState::Capture(PxScene* scene)
+	{
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+		bodies.resize(scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC));
+		if (bodies.size())
+			scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, (PxActor**)&bodies.front(), (PxU32)bodies.size());
+		cloths.resize(scene->getNbActors(PxActorTypeSelectionFlag::eCLOTH));
+		if (cloths.size())
+			scene->getActors(PxActorTypeSelectionFlag::eCLOTH, (PxActor**)&cloths.front(), (PxU32)cloths.size());
+#else
+		bodies.resize(scene->getNbActors(PxActorTypeFlag::eRIGID_DYNAMIC));
+		if (bodies.size())
+			scene->getActors(PxActorTypeFlag::eRIGID_DYNAMIC, (PxActor**)&bodies.front(), (PxU32)bodies.size());
+		cloths.resize(scene->getNbActors(PxActorTypeFlag::eCLOTH));
+		if (cloths.size())
+			scene->getActors(PxActorTypeFlag::eCLOTH, (PxActor**)&cloths.front(), (PxU32)cloths.size());
+#endif
+
+		body_poses.resize(bodies.size());
+		linear_velocities.resize(bodies.size());
+		angular_velocities.resize(bodies.size());
+		sleeping.resize(bodies.size());
+		for (PxU32 i = 0; i < bodies.size(); i++)
+		{
+			body_poses[i] = bodies[i]->getGlobalPose();
+			linear_velocities[i] = bodies[i]->getLinearVelocity();
+			angular_velocities[i] = bodies[i]->getAngularVelocity();
+			sleeping[i] = bodies[i]->isSleeping();
+		}
+
+		cloth_poses.resize(cloths.size());
+		cloth_sleeping.resize(cloths.size());
+		particle_offsets.resize(cloths.size()+1);
+		particles.clear();
+		for (PxU32 i = 0; i < cloths.size(); i++)
+		{
+			cloth_poses[i] = cloths[i]->getGlobalPose();
+			cloth_sleeping[i] = cloths[i]->isSleeping();
+			particle_offsets[i] = (PxU32)particles.size();
+			PxClothParticleData* particle_data = cloths[i]->lockParticleData();
+			if (particle_data)
+			{
+				particles.insert(particles.end(), particle_data->particles, particle_data->particles + cloths[i]->getNbParticles());
+				particle_data->unlock();
+			}
+		}
+		particle_offsets[cloths.size()] = (PxU32)particles.size();
+	}
+
+	void SceneState::Restore() const
+	{
+		for (PxU32 i = 0; i < bodies.size(); i++)
+		{
+			PxRigidDynamic* body = bodies[i];
+			body->setGlobalPose(body_poses[i]);
+			//kinematic bodies have no velocities or forces
+			if (body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC)
+				continue;
+			body->clearForce();
+			body->clearTorque();
+			body->setLinearVelocity(linear_velocities[i], false);
+			body->setAngularVelocity(angular_velocities[i], false);
+			if (sleeping[i])
+				body->putToSleep();
+			else
+				body->wakeUp();
+		}
+
+		for (PxU32 i = 0; i < cloths.size(); i++)
+		{
+			cloths[i]->setGlobalPose(cloth_poses[i]);
+			//same current and previous positions: particles at rest
+			if (particle_offsets[i+1] > particle_offsets[i])
+				cloths[i]->setParticles(&particles[particle_offsets[i]], &particles[particle_offsets[i]]);
+			if (cloth_sleeping[i])
+				cloths[i]->putToSleep();
+			else
+				cloths[i]->wakeUp();
+		}
 	}
 
 	///Scene methods
-	void Scene::Init()
+	Scene::Scene(PxU32 _worker_count)
+		: px_scene(0), scheduler(0), worker_count(_worker_count), simulating(false), front_snapshot(0),
+		fixed_step(1.f/60.f), substeps(1), max_steps(4), accumulator(0.f), initial_actors(0), initial_valid(false), fast_reset(true),
+		collection(0), scene_file(0), broadphase_type(PxBroadPhaseType::eSAP), broadphase_subdivisions(4),
+		ccd_mode(CCDMode::OFF), selected_force(0.f)
+	{
+		//use all cores but the one running the render loop
+		if (worker_count == -1)
+			worker_count = PxMax(std::thread::hardware_concurrency(), 2u) - 1;
+
+		//environment override, e.g. PHYSX_WORKER_COUNT=4
+		char* env = 0;
+		size_t env_size = 0;
+		if ((_dupenv_s(&env, &env_size, "PHYSX_WORKER_COUNT") == 0) && env)
+		{
+			int value = atoi(env);
+			if (value > 0)
+				worker_count = (PxU32)value;
+			free(env);
+		}
+	}
+
+	Scene::~Scene()
+	{
+		if (px_scene)
+		{
+			if (simulating)
+				px_scene->fetchResults(true);
+			DeleteActors();
+			px_scene->release();
+		}
+		if (scheduler)
+			scheduler->release();
+	}
+
+	void Scene::CreateScene()
 	{
 		//scene
 		PxSceneDesc sceneDesc(GetPhysics()->getTolerancesScale());
 
-		if(!sceneDesc.cpuDispatcher)
+		//the worker pool outlives the scene so that Reset does not spawn new threads
+		if (!scheduler)
+			scheduler = new TaskScheduler(worker_count);
+
+		sceneDesc.cpuDispatcher = scheduler;
+
+		//group pairs are filtered by a table lookup, the table is copied by PhysX
+		sceneDesc.filterShader = TableFilterShader;
+		sceneDesc.filterShaderData = &filter_table;
+		sceneDesc.filterShaderDataSize = sizeof(FilterTable);
+
+		//MBP regions are added once the actors are in (see CreateBroadPhaseRegions)
+		sceneDesc.broadPhaseType = broadphase_type;
+		if (broadphase_type == PxBroadPhaseType::eMBP)
 		{
-			PxDefaultCpuDispatcher* mCpuDispatcher = PxDefaultCpuDispatcherCreate(1);
-			sceneDesc.cpuDispatcher = mCpuDispatcher;
+			sceneDesc.broadPhaseCallback = &broadphase_monitor;
+			sceneDesc.limits.maxNbRegions = broadphase_subdivisions * broadphase_subdivisions;
 		}
+		broadphase_monitor.out_of_bounds = 0;
 
-		sceneDesc.filterShader = PxDefaultSimulationFilterShader;
+		if (ccd_mode != CCDMode::OFF)
+			sceneDesc.flags |= PxSceneFlag::eENABLE_CCD;
 
 		px_scene = GetPhysics()->createScene(sceneDesc);
 
@@ -264,30 +784,511 @@ namespace PhysicsEngine
 
 		//default gravity
 		px_scene->setGravity(PxVec3(0.0f, -9.81f, 0.0f));
+	}
+
+	void Scene::Init()
+	{
+		CreateScene();
 
 		CustomInit();
 
+		InitState();
+	}
+
+	//rigid actor of a collection, 0 for other objects
+	static PxRigidActor* RigidActor(PxBase& object)
+	{
+		PxType type = object.getConcreteType();
+		if ((type == PxConcreteType::eRIGID_DYNAMIC) || (type == PxConcreteType::eRIGID_STATIC))
+			return (PxRigidActor*)&object;
+		else
+			return 0;
+	}
+
+	//arena id of an exclusive shape or of the shared shapes of a rigid actor
+	static PxU32 RenderId(PxBase& object)
+	{
+		if (object.getConcreteType() == PxConcreteType::eSHAPE)
+			return GetShapeId((PxShape*)&object);
+		else if (PxRigidActor* actor = RigidActor(object))
+			return GetActorId(actor);
+		else
+			return ShapeArena::invalid_id;
+	}
+
+	void Scene::Load(const std::string& filename)
+	{
+		CreateScene();
+
+		scene_file = new SceneFile(filename);
+		scene_filename = filename;
+
+		//deserialize in place, materials are shared with the registry
+		PxSerializationRegistry* registry = PxSerialization::createSerializationRegistry(*GetPhysics());
+		PxCollection* materials = CreateMaterialCollection();
+		collection = PxSerialization::createCollectionFromBinary(scene_file->Collection(), *registry, materials);
+		materials->release();
+		registry->release();
+
+		if (!collection)
+		{
+			delete scene_file;
+			scene_file = 0;
+			throw new Exception("PhysicsEngine::Scene::Load, Could not deserialize " + filename + " (different PhysX build or materials).");
+		}
+
+		px_scene->addCollection(*collection);
+
+		//render attributes: defaults for all exclusive shapes and all actors with shared shapes, then the stored ones
+		for (PxU32 i = 0; i < collection->getNbObjects(); i++)
+		{
+			PxBase& object = collection->getObject(i);
+			if (object.getConcreteType() == PxConcreteType::eSHAPE)
+			{
+				PxShape* shape = (PxShape*)&object;
+				shape->userData = 0;
+				if (shape->isExclusive())
+					SetShapeId(shape, GetShapeArena().Allocate(default_color));
+			}
+			else if (PxRigidActor* actor = RigidActor(object))
+			{
+				actor->userData = 0;
+				for (PxU32 j = 0; j < actor->getNbShapes(); j++)
+				{
+					PxShape* shape;
+					actor->getShapes(&shape, 1, j);
+					if (!shape->isExclusive())
+					{
+						SetActorId(actor, GetShapeArena().Allocate(default_color));
+						break;
+					}
+				}
+			}
+		}
+
+		const SceneFile::Header& header = scene_file->GetHeader();
+		const SceneFile::ShapeEntry* shapes = scene_file->Shapes();
+		for (PxU32 i = 0; i < header.nb_shapes; i++)
+		{
+			PxBase* object = collection->find(shapes[i].id);
+			PxU32 id = object ? RenderId(*object) : ShapeArena::invalid_id;
+			if (id != ShapeArena::invalid_id)
+			{
+				GetShapeArena().Color(id) = shapes[i].color;
+				GetShapeArena().Flags(id) = shapes[i].flags;
+			}
+		}
+
+		//wrappers in the order the actors were added
+		for (PxU32 i = 0; i < header.nb_actors; i++)
+		{
+			PxBase* object = collection->find(i + 1);
+			if (!object)
+				throw new Exception("PhysicsEngine::Scene::Load, Missing actor in " + filename + ".");
+			actors.push_back(new LoadedActor((PxActor*)object));
+			RegisterCCD(actors.back());
+		}
+
+		CustomLoad();
+
+		InitState();
+	}
+
+	void Scene::Save(const std::string& filename)
+	{
+		EndStep();
+
+		PxSerializationRegistry* registry = PxSerialization::createSerializationRegistry(*GetPhysics());
+		PxCollection* materials = CreateMaterialCollection();
+
+		//actors and joints, the rigid scene actors get the ids 1..n in the order they were added;
+		//cloths are left out, their user data points to the fabric pool of this process
+		PxCollection* scene_collection = PxCollectionExt::createCollection(*px_scene);
+		PxU32 nb_actors = 0;
+		for (PxU32 i = 0; i < actors.size(); i++)
+		{
+			PxActor* actor = actors[i]->Get();
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			if (actor->isCloth())
+#else
+			if (actor->is<PxCloth>())
+#endif
+			{
+				if (scene_collection->contains(*actor))
+					scene_collection->remove(*actor);
+				continue;
+			}
+			//actors of aggregates are only in the collection through their aggregate
+			if (scene_collection->contains(*actor))
+				scene_collection->addId(*actor, PxSerialObjectId(++nb_actors));
+			else
+				scene_collection->add(*actor, PxSerialObjectId(++nb_actors));
+		}
+
+		//shapes and meshes
+		PxSerialization::complete(*scene_collection, *registry, materials);
+		PxSerialization::createSerialObjectIds(*scene_collection, PxSerialObjectId(nb_actors + 1));
+
+		if (!PxSerialization::isSerializable(*scene_collection, *registry, materials))
+		{
+			scene_collection->release();
+			materials->release();
+			registry->release();
+			throw new Exception("PhysicsEngine::Scene::Save, The scene can not be serialized.");
+		}
+
+		PxDefaultMemoryOutputStream stream;
+		bool serialized = PxSerialization::serializeCollectionToBinary(stream, *scene_collection, *registry, materials, true);
+
+		//render attributes, the selection highlight is not stored
+		std::vector<SceneFile::ShapeEntry> shapes;
+		for (PxU32 i = 0; i < scene_collection->getNbObjects(); i++)
+		{
+			PxBase& object = scene_collection->getObject(i);
+			PxU32 id = RenderId(object);
+			if (id == ShapeArena::invalid_id)
+				continue;
+			SceneFile::ShapeEntry entry;
+			entry.id = scene_collection->getId(object);
+			entry.color = GetShapeArena().Color(id);
+			entry.flags = GetShapeArena().Flags(id) & ~RenderFlag::HIGHLIGHT;
+			shapes.push_back(entry);
+		}
+
+		scene_collection->release();
+		materials->release();
+		registry->release();
+
+		if (!serialized)
+			throw new Exception("PhysicsEngine::Scene::Save, Could not serialize the scene.");
+
+		SceneFile::Write(filename, nb_actors, stream.getData(), stream.getSize(), shapes.data(), (PxU32)shapes.size());
+	}
+
+	void Scene::CreateBroadPhaseRegions()
+	{
+		if (px_scene->getBroadPhaseType() != PxBroadPhaseType::eMBP)
+			return;
+
+		std::vector<PxBounds3> regions(broadphase_subdivisions * broadphase_subdivisions);
+		PxU32 count = PxBroadPhaseExt::createRegionsFromWorldBounds(regions.data(), WorldBounds(), broadphase_subdivisions);
+		for (PxU32 i = 0; i < count; i++)
+		{
+			PxBroadPhaseRegion region;
+			region.bounds = regions[i];
+			region.userData = 0;
+			//the actors are already in the scene
+			if (px_scene->addBroadPhaseRegion(region, true) == 0xffffffff)
+				throw new Exception("PhysicsEngine::Scene::CreateBroadPhaseRegions, Could not add a broadphase region.");
+		}
+	}
+
+	void Scene::InitState()
+	{
+		CreateBroadPhaseRegions();
+
+		//remember the initial set of actors and their state for a fast Reset
+		initial_actors = (PxU32)actors.size();
+		initial_state.Capture(px_scene);
+		initial_valid = true;
+
 		pause = false;
 
 		selected_actor = 0;
 
 		SelectNextActor();
+
+		simulating = false;
+		accumulator = 0.f;
+
+		EndStep();
 	}
 
 	void Scene::Update(PxReal dt)
 	{
-		if (pause)
+		//blocking step, no snapshot needed
+		BeginStep(dt);
+		if (simulating)
+		{
+			px_scene->fetchResults(true);
+			simulating = false;
+		}
+	}
+
+	void Scene::BeginStep(PxReal dt)
+	{
+		if (pause || simulating)
 			return;
 
 		CustomUpdate();
 
-		px_scene->simulate(dt);
-		px_scene->fetchResults(true);
+		//all substeps but the last one block
+		PxReal sub_dt = dt / substeps;
+		for (PxU32 i = 1; i < substeps; i++)
+		{
+			PreSimulate(sub_dt);
+			px_scene->simulate(sub_dt);
+			px_scene->fetchResults(true);
+		}
+
+		PreSimulate(sub_dt);
+		px_scene->simulate(sub_dt);
+		simulating = true;
+	}
+
+	void Scene::PreSimulate(PxReal sub_dt)
+	{
+		aerodynamics.Apply();
+		ccd.Update(sub_dt);
+
+		//forces are cleared by PhysX after each simulate
+		if (selected_actor && !selected_force.isZero())
+			selected_actor->addForce(selected_force);
+	}
+
+	void Scene::EndStep()
+	{
+		if (simulating)
+		{
+			px_scene->fetchResults(true);
+			simulating = false;
+
+			//a new step: fill the back buffer and flip, the old front becomes the previous state
+			snapshots[1 - front_snapshot].Capture(px_scene, scheduler);
+			front_snapshot = 1 - front_snapshot;
+		}
+		else
+		{
+			//no step, only refresh the actor list (spawned or released actors)
+			snapshots[front_snapshot].Capture(px_scene, scheduler);
+		}
+	}
+
+	const PoseSnapshot& Scene::Snapshot()
+	{
+		return snapshots[front_snapshot];
+	}
+
+	const PoseSnapshot& Scene::PreviousSnapshot()
+	{
+		return snapshots[1 - front_snapshot];
+	}
+
+	void Scene::SetTimeStep(PxReal step, PxU32 _substeps, PxU32 _max_steps)
+	{
+		fixed_step = step;
+		substeps = PxMax(_substeps, 1u);
+		max_steps = PxMax(_max_steps, 1u);
+	}
+
+	PxU32 Scene::Substeps()
+	{
+		return substeps;
+	}
+
+	PxU32 Scene::Advance(PxReal frame_time)
+	{
+		if (pause)
+		{
+			accumulator = 0.f;
+			return 0;
+		}
+
+		//drop the time we cannot catch up with (avoids the spiral of death)
+		accumulator = PxMin(accumulator + frame_time, fixed_step * max_steps);
+
+		PxU32 steps = 0;
+		while (accumulator >= fixed_step)
+		{
+			//every step is captured so that the last two snapshots are always consecutive,
+			//this also finishes a step still running from the previous call
+			if (simulating)
+				EndStep();
+			BeginStep(fixed_step);
+			//only time that was actually simulated is consumed
+			if (!simulating)
+				break;
+			accumulator -= fixed_step;
+			steps++;
+		}
+		return steps;
+	}
+
+	PxReal Scene::Alpha()
+	{
+		return accumulator / fixed_step;
+	}
+
+	void Scene::Add(Actor* actor, Aggregate* aggregate)
+	{
+		//actors added to an aggregate in the scene are inserted into the scene
+		if (aggregate)
+			aggregate->Add(actor);
+		else
+			px_scene->addActor(*actor->Get());
+		actors.push_back(actor);
+		RegisterCCD(actor);
+	}
+
+	void Scene::Add(Aggregate* aggregate)
+	{
+		px_scene->addAggregate(*aggregate->Get());
+		aggregates.push_back(aggregate);
+	}
+
+	void Scene::Add(SceneQueryBatch* batch)
+	{
+		query_batches.push_back(batch);
+	}
+
+	void Scene::AddBatch(const std::vector<Actor*>& batch, bool pruning_structure)
+	{
+		//rigid actors are inserted together, others (cloth) one by one
+		std::vector<PxActor*>& rigid_actors = batch_actors;
+		rigid_actors.clear();
+		for (PxU32 i = 0; i < batch.size(); i++)
+		{
+			PxActor* actor = batch[i]->Get();
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			if (actor->isRigidActor())
+#else
+			if (actor->is<PxRigidActor>())
+#endif
+				rigid_actors.push_back(actor);
+			else
+				px_scene->addActor(*actor);
+			actors.push_back(batch[i]);
+			RegisterCCD(batch[i]);
+		}
+
+		if (rigid_actors.empty())
+			return;
+
+#if PX_PHYSICS_VERSION >= 0x304000 // SDK 3.4
+		if (pruning_structure)
+		{
+			std::vector<PxRigidActor*>& rigid = batch_rigid_actors;
+			rigid.clear();
+			for (PxU32 i = 0; i < rigid_actors.size(); i++)
+				rigid.push_back((PxRigidActor*)rigid_actors[i]);
+
+			PxPruningStructure* structure = GetPhysics()->createPruningStructure(rigid.data(), (PxU32)rigid.size());
+			if (!structure)
+				throw new Exception("PhysicsEngine::Scene::AddBatch, Could not create the pruning structure.");
+
+			//the scene takes over the trees, the structure itself is not needed any more
+			px_scene->addActors(*structure);
+			structure->release();
+			return;
+		}
+#endif
+
+		px_scene->addActors(rigid_actors.data(), (PxU32)rigid_actors.size());
+	}
+
+	void Scene::Unlink(Actor* actor, const char* caller)
+	{
+		std::vector<Actor*>::iterator it = std::find(actors.begin(), actors.end(), actor);
+		if (it == actors.end())
+			throw new Exception(std::string("PhysicsEngine::Scene::") + caller + ", The actor is not in the scene.");
+
+		//removing an initial actor makes the captured state unusable
+		if ((PxU32)(it - actors.begin()) < initial_actors)
+		{
+			initial_actors--;
+			initial_valid = false;
+		}
+		actors.erase(it);
+
+		//do not keep a dangling selection
+		if (selected_actor && (selected_actor == actor->Get()))
+		{
+			SelectNextActor();
+			if (selected_actor == actor->Get())
+			{
+				HighlightOff(selected_actor);
+				selected_actor = 0;
+			}
+		}
+	}
+	void Scene::Remove(Actor* actor)
+	{
+		Unlink(actor, "Remove");
+		DeleteActor(actor);
 	}
+	void Scene::Detach(Actor* actor)
+	{
+		//loaded actors live in the mapped scene file
+		if (collection && collection->contains(*actor->Get()))
+			throw new Exception("PhysicsEngine::Scene::Detach, Loaded actors cannot be detached.");
 
-	void Scene::Add(Actor* actor)
+		Unlink(actor, "Detach");
+		aerodynamics.Remove(actor->Get());
+		ccd.Remove(actor->Get());
+		px_scene->removeActor(*actor->Get());
+	}
+	void Scene::DeleteActor(Actor* actor)
 	{
-		px_scene->addActor(*actor->Get());
+		PxActor* px_actor = actor->Get();
+
+		//a loaded actor is released here, not with the rest of the collection;
+		//shared shapes may still be used by other loaded actors and stay in the collection
+		if (collection && collection->contains(*px_actor))
+		{
+			std::vector<PxShape*> shapes = actor->GetShapes();
+			for (PxU32 i = 0; i < shapes.size(); i++)
+			{
+				if (shapes[i]->isExclusive() && collection->contains(*shapes[i]))
+					collection->remove(*shapes[i]);
+			}
+			collection->remove(*px_actor);
+		}
+
+		aerodynamics.Remove(px_actor);
+		ccd.Remove(px_actor);
+
+		//the wrapper still needs its shapes, release the PhysX actor last
+		delete actor;
+		px_actor->release();
+	}
+
+	void Scene::DeleteActors()
+	{
+		for (PxU32 i = 0; i < actors.size(); i++)
+			DeleteActor(actors[i]);
+		actors.clear();
+		for (PxU32 i = 0; i < aggregates.size(); i++)
+			delete aggregates[i];
+		aggregates.clear();
+		for (PxU32 i = 0; i < query_batches.size(); i++)
+			delete query_batches[i];
+		query_batches.clear();
+		initial_actors = 0;
+		initial_valid = false;
+		selected_actor = 0;
+
+		//joints and meshes of a loaded scene, they live in the mapped file
+		if (collection)
+		{
+			PxCollectionExt::releaseObjects(*collection);
+			collection->release();
+			collection = 0;
+		}
+		if (scene_file)
+		{
+			delete scene_file;
+			scene_file = 0;
+		}
+	}
+
+	Actor* Scene::Find(const std::string& name)
+	{
+		for (PxU32 i = 0; i < actors.size(); i++)
+		{
+			if (actors[i]->Name() == name)
+				return actors[i];
+		}
+		return 0;
 	}
 
 	PxScene* Scene::Get() 
@@ -295,10 +1296,160 @@ namespace PhysicsEngine
 		return px_scene; 
 	}
 
+	Aerodynamics& Scene::GetAerodynamics()
+	{
+		return aerodynamics;
+	}
+
 	void Scene::Reset()
 	{
-		px_scene->release();
-		Init();
+		EndStep();
+		CustomReset();
+
+		if (!fast_reset || !initial_valid)
+		{
+			//full rebuild
+			DeleteActors();
+			px_scene->release();
+			if (scene_filename.empty())
+				Init();
+			else
+				Load(scene_filename);
+			return;
+		}
+
+		if (selected_actor)
+			HighlightOff(selected_actor);
+		selected_actor = 0;
+
+		//delete everything spawned after CustomInit
+		while (actors.size() > initial_actors)
+		{
+			DeleteActor(actors.back());
+			actors.pop_back();
+		}
+
+		initial_state.Restore();
+
+		pause = false;
+		SelectNextActor();
+		accumulator = 0.f;
+
+		//no blending with the poses before the reset
+		snapshots[0].Capture(px_scene, scheduler);
+		snapshots[1].Capture(px_scene, scheduler);
+	}
+
+	void Scene::SetFilterTable(const FilterTable& table)
+	{
+		filter_table = table;
+		if (!px_scene)
+			return;
+
+		EndStep();
+		px_scene->setFilterShaderData(&filter_table, sizeof(FilterTable));
+
+		//pairs are only filtered when they are created, existing (and killed) pairs are filtered again
+		for (PxU32 i = 0; i < actors.size(); i++)
+		{
+			if (PxRigidActor* actor = actors[i]->Get()->is<PxRigidActor>())
+				px_scene->resetFiltering(*actor);
+		}
+	}
+
+	const FilterTable& Scene::GetFilterTable()
+	{
+		return filter_table;
+	}
+
+	void Scene::BroadPhase(PxBroadPhaseType::Enum type, PxU32 subdivisions)
+	{
+		broadphase_type = type;
+		broadphase_subdivisions = PxMax(subdivisions, 1u);
+	}
+
+	PxBroadPhaseType::Enum Scene::BroadPhase()
+	{
+		return broadphase_type;
+	}
+
+	PxBounds3 Scene::WorldBounds()
+	{
+		const PxReal margin = 10.f, height = 1e4f;
+
+		PxBounds3 bounds = PxBounds3::empty();
+		for (PxU32 i = 0; i < actors.size(); i++)
+		{
+			PxRigidStatic* actor = actors[i]->Get()->is<PxRigidStatic>();
+			if (!actor)
+				continue;
+
+			//planes are unbounded
+			std::vector<PxShape*> shapes = actors[i]->GetShapes();
+			for (PxU32 j = 0; j < shapes.size(); j++)
+			{
+				if (shapes[j]->getGeometryType() != PxGeometryType::ePLANE)
+					bounds.include(PxShapeExt::getWorldBounds(*shapes[j], *actor));
+			}
+		}
+
+		if (bounds.isEmpty())
+			bounds = PxBounds3(PxVec3(-100.f), PxVec3(100.f));
+
+		bounds.minimum -= PxVec3(margin);
+		bounds.maximum += PxVec3(margin);
+		bounds.minimum.y = -height;
+		bounds.maximum.y = height;
+		return bounds;
+	}
+
+	PxU32 Scene::OutOfBounds()
+	{
+		return broadphase_monitor.out_of_bounds;
+	}
+
+	void Scene::RegisterCCD(Actor* actor)
+	{
+		if (ccd_mode == CCDMode::OFF)
+			return;
+
+		PxRigidDynamic* body = actor->Get()->is<PxRigidDynamic>();
+		if (!body)
+			return;
+
+		if (ccd_mode == CCDMode::ADAPTIVE)
+			ccd.Add(body);
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+		else if (!(body->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC))
+#else
+		else if (!(body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC))
+#endif
+			body->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_CCD, true);
+	}
+
+	void Scene::ContinuousCollision(CCDMode::Enum mode)
+	{
+		ccd_mode = mode;
+	}
+
+	CCDMode::Enum Scene::ContinuousCollision()
+	{
+		return ccd_mode;
+	}
+
+	AdaptiveCCD& Scene::GetCCD()
+	{
+		return ccd;
+	}
+
+	void Scene::FastReset(bool value)
+	{
+		fast_reset = value;
+	}
+
+	bool Scene::FastReset()
+	{
+		return fast_reset;
 	}
 
 	void Scene::Pause(bool value)
@@ -311,11 +1462,31 @@ namespace PhysicsEngine
 		return pause;
 	}
 
+	PxU32 Scene::WorkerCount()
+	{
+		return worker_count;
+	}
+
+	TaskScheduler* Scene::GetScheduler()
+	{
+		return scheduler;
+	}
+
 	PxRigidDynamic* Scene::GetSelectedActor()
 	{
 		return selected_actor;
 	}
 
+	void Scene::SelectedForce(const PxVec3& force)
+	{
+		selected_force = force;
+	}
+
+	const PxVec3& Scene::SelectedForce()
+	{
+		return selected_force;
+	}
+
 	void Scene::SelectNextActor()
 	{
 #if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
@@ -363,27 +1534,28 @@ namespace PhysicsEngine
 
 	void Scene::HighlightOn(PxRigidDynamic* actor)
 	{
-		//store the original colour and adjust brightness of the selected actor
-		std::vector<PxShape*> shapes(actor->getNbShapes());
-		actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
-
-		sactor_color_orig.clear();
-
-		for (unsigned int i = 0; i < shapes.size(); i++)
+		//the renderer adjusts brightness of the selected actor
+		PxU32 nb_shapes = actor->getNbShapes();
+		for (PxU32 i = 0; i < nb_shapes; i++)
 		{
-			PxVec3* color = ((UserData*)shapes[i]->userData)->color;
-			sactor_color_orig.push_back(*color);
-			*color += PxVec3(.2f,.2f,.2f);
+			PxShape* shape;
+			actor->getShapes(&shape, 1, i);
+			PxU32 id = GetShapeId(shape, actor);
+			if (id != ShapeArena::invalid_id)
+				GetShapeArena().Flags(id) |= RenderFlag::HIGHLIGHT;
 		}
 	}
 
 	void Scene::HighlightOff(PxRigidDynamic* actor)
 	{
-		//restore the original color
-		std::vector<PxShape*> shapes(actor->getNbShapes());
-		actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
-
-		for (unsigned int i = 0; i < shapes.size(); i++)
-			*((UserData*)shapes[i]->userData)->color = sactor_color_orig[i];
+		PxU32 nb_shapes = actor->getNbShapes();
+		for (PxU32 i = 0; i < nb_shapes; i++)
+		{
+			PxShape* shape;
+			actor->getShapes(&shape, 1, i);
+			PxU32 id = GetShapeId(shape, actor);
+			if (id != ShapeArena::invalid_id)
+				GetShapeArena().Flags(id) &= ~RenderFlag::HIGHLIGHT;
+		}
 	}
-}
+}
\ No newline at end of file
@@ -4,6 +4,17 @@
 #include "PxPhysicsAPI.h"
 #include "Exception.h"
 #include "Extras\UserData.h"
+#include "Extras\TaskScheduler.h"
+#include "TrackingAllocator.h"
+#include "SceneFile.h"
+#include "MeshCache.h"
+#include "MeshLibrary.h"
+#include "ClothFabricPool.h"
+#include "ShapeRegistry.h"
+#include "Aerodynamics.h"
+#include "FilterTable.h"
+#include "AdaptiveCCD.h"
+#include "SceneQueryBatch.h"
 #include <string>
 
 namespace PhysicsEngine
@@ -17,18 +28,42 @@ namespace PhysicsEngine
 	///Release PhysX resources
 	void PxRelease();
 
+	///Get the allocator used by PhysX
+	TrackingAllocator& GetAllocator();
+
+	///Print PhysX memory usage, limited to the max_names largest names
+	void DumpAllocationStats(std::ostream& out, PxU32 max_names=-1);
+
 	///Get the PxPhysics object
 	PxPhysics* GetPhysics();
 
 	///Get the cooking object
 	PxCooking* GetCooking();
 
-	///Get the specified material
+	///Get the specified material (index in the order of creation, 0 is the default material)
 	PxMaterial* GetMaterial(PxU32 index=0);
 
-	///Create a new material
+	///Create a new material, or get the existing one with the same coefficients
 	PxMaterial* CreateMaterial(PxReal sf=.0f, PxReal df=.0f, PxReal cr=.0f);
 
+	///Create (or reuse) a material and register it under a name
+	PxMaterial* CreateMaterial(const std::string& name, PxReal sf, PxReal df, PxReal cr);
+
+	///Same as CreateMaterial but returns the material index
+	PxU32 CreateMaterialIndex(PxReal sf=.0f, PxReal df=.0f, PxReal cr=.0f);
+
+	///Get the index of a named material, -1 if the name is not registered
+	PxU32 GetMaterialIndex(const std::string& name);
+
+	///Get a named material, 0 if the name is not registered
+	PxMaterial* FindMaterial(const std::string& name);
+
+	///Number of registered materials
+	PxU32 GetMaterialCount();
+
+	///A collection with all registered materials, used as external references by Scene::Save and Scene::Load
+	PxCollection* CreateMaterialCollection();
+
 	static const PxVec3 default_color(.8f,.8f,.8f);
 
 	///Abstract Actor class
@@ -37,20 +72,45 @@ namespace PhysicsEngine
 	{
 	protected:
 		PxActor* actor;
-		std::vector<PxVec3> colors;
+		//render attributes of actors without shapes (cloth) and of shared shapes, see ShapeArena
+		PxU32 color_id;
 		std::string name;
 
+		//shapes created by this actor, cached to avoid querying PhysX;
+		//the first inline_shapes are stored in place (no heap allocation for typical actors)
+		static const PxU32 inline_shapes = 8;
+		PxShape* shape_buffer[inline_shapes];
+		std::vector<PxShape*> shape_overflow;
+		PxU32 shape_count;
+
+		///Append a newly created shape to the cache
+		void AddShape(PxShape* shape);
+
+		///Cached shapes, ShapeCount() elements
+		PxShape* const* ShapeArray() const;
+
+		///Attach a shared shape, the actor gets a render id for its shared shapes
+		void AttachShape(PxShape* shape);
+
+		///Swap a shape for another one (e.g. a shared shape with a different material)
+		void ReplaceShape(PxU32 index, PxShape* shape);
+
 	public:
 		///Constructor
 		Actor()
-			: actor(0)
+			: actor(0), color_id(ShapeArena::invalid_id), shape_count(0)
 		{
 		}
 
+		///Actors are deleted through Actor* by the scene
+		virtual ~Actor() {}
+
 		PxActor* Get();
 
+		///Shared shapes have a single colour per actor, setting the colour of one sets all of them
 		void Color(PxVec3 new_color, PxU32 shape_index=-1);
 
+		///The returned pointer is only valid until the next shape is created
 		const PxVec3* Color(PxU32 shape_indx=0);
 
 		void Actor::Name(const string& name);
@@ -63,8 +123,14 @@ namespace PhysicsEngine
 
 		std::vector<PxShape*> Actor::GetShapes(PxU32 index=-1);
 
+		///Number of shapes created by this actor
+		PxU32 ShapeCount() const;
+
 		virtual void CreateShape(const PxGeometry& geometry, PxReal density) {}
 		void SetTrigger(bool value, PxU32 shape_index = -1);
+
+		///Set the filter group (index into the scene FilterTable) of the shapes, or of the whole cloth
+		void SetupFiltering(PxU32 group, PxU32 shape_index=-1);
 	};
 
 	class DynamicActor : public Actor
@@ -76,6 +142,9 @@ namespace PhysicsEngine
 
 		void CreateShape(const PxGeometry& geometry, PxReal density);
 
+		///Attach a shared shape from the ShapeRegistry instead of creating an exclusive one
+		void CreateSharedShape(const PxGeometry& geometry, PxReal density, const PxTransform& local_pose=PxTransform(PxIdentity));
+
 		void SetKinematic(bool value, PxU32 index=-1);
 	};
 
@@ -87,6 +156,96 @@ namespace PhysicsEngine
 		~StaticActor();
 
 		void CreateShape(const PxGeometry& geometry, PxReal density=0.f);
+
+		///Attach a shared shape from the ShapeRegistry instead of creating an exclusive one
+		void CreateSharedShape(const PxGeometry& geometry, const PxTransform& local_pose=PxTransform(PxIdentity));
+	};
+
+	///Wrapper of an actor that was not created by an Actor class (e.g. loaded by Scene::Load)
+	class LoadedActor : public Actor
+	{
+	public:
+		LoadedActor(PxActor* actor);
+
+		~LoadedActor();
+	};
+
+	///Group of actors that the broadphase treats as a single bounding box,
+	///pairs inside the group are only tested with self collision
+	class Aggregate
+	{
+	protected:
+		PxAggregate* aggregate;
+
+	public:
+		///At most max_actors (up to 128) actors
+		Aggregate(PxU32 max_actors, bool self_collision=false);
+
+		///Release the PhysX aggregate, its actors stay in the scene
+		~Aggregate();
+
+		///Add an actor that is not in a scene yet, see Scene::Add
+		void Add(Actor* actor);
+
+		PxAggregate* Get();
+	};
+
+	///Render state of the scene captured at the end of a simulation step.
+	///Drawing from a snapshot is safe while the next step is running.
+	class PoseSnapshot
+	{
+	public:
+		std::vector<PxActor*> actors;
+		//global pose of each actor
+		std::vector<PxTransform> poses;
+		//cloth particles of actor i are in [particle_offsets[i], particle_offsets[i+1])
+		std::vector<PxU32> particle_offsets;
+		std::vector<PxVec3> particles;
+
+		///Copy the current state of all rigid actors and cloths
+		void Capture(PxScene* scene, TaskScheduler* scheduler=0);
+
+		///Blend the poses of the previous snapshot into this one (alpha=1 gives this snapshot).
+		///Actors that do not appear at the same index in both snapshots are not blended.
+		void Interpolate(const PoseSnapshot& previous, PxReal alpha, std::vector<PxTransform>& result) const;
+	};
+
+	///Dynamic state of the scene (bodies and cloths), captured once and restored by Scene::Reset.
+	///Static actors do not move and are not stored.
+	class SceneState
+	{
+	public:
+		std::vector<PxRigidDynamic*> bodies;
+		std::vector<PxTransform> body_poses;
+		std::vector<PxVec3> linear_velocities;
+		std::vector<PxVec3> angular_velocities;
+		std::vector<bool> sleeping;
+
+		std::vector<PxCloth*> cloths;
+		std::vector<PxTransform> cloth_poses;
+		std::vector<bool> cloth_sleeping;
+		//particles of cloth i are in [particle_offsets[i], particle_offsets[i+1])
+		std::vector<PxU32> particle_offsets;
+		std::vector<PxClothParticle> particles;
+
+		///Store the state of all dynamic actors in the scene
+		void Capture(PxScene* scene);
+
+		///Put the captured actors back, they must still exist
+		void Restore() const;
+	};
+
+	///Counts the objects leaving the MBP regions, they are not in the broadphase any more
+	class BroadPhaseMonitor : public PxBroadPhaseCallback
+	{
+	public:
+		PxU32 out_of_bounds;
+
+		BroadPhaseMonitor() : out_of_bounds(0) {}
+
+		virtual void onObjectOutOfBounds(PxShape& shape, PxActor& actor) { out_of_bounds++; }
+
+		virtual void onObjectOutOfBounds(PxAggregate& aggregate) { out_of_bounds++; }
 	};
 
 	///Generic scene class
@@ -95,55 +254,317 @@ namespace PhysicsEngine
 	protected:
 		//a PhysX scene object
 		PxScene* px_scene;
+		//worker pool used by the simulation and the renderer, shared across resets
+		TaskScheduler* scheduler;
+		PxU32 worker_count;
 		//pause simulation
 		bool pause;
 		//selected dynamic actor on the scene
 		PxRigidDynamic* selected_actor;
-		//original and modified colour of the selected actor
-		std::vector<PxVec3> sactor_color_orig;
+		//a step is running between BeginStep and EndStep
+		bool simulating;
+		//double-buffered render state, the front one is read by the renderer
+		PoseSnapshot snapshots[2];
+		PxU32 front_snapshot;
+		//fixed time step: step length, simulate calls per step and catch-up limit
+		PxReal fixed_step;
+		PxU32 substeps;
+		PxU32 max_steps;
+		//real time not simulated yet
+		PxReal accumulator;
+		//actors added to the scene, the scene deletes them
+		std::vector<Actor*> actors;
+		//aggregates added to the scene, deleted with the actors
+		std::vector<Aggregate*> aggregates;
+		//query batches of the scene, deleted with the actors (before the PhysX scene)
+		std::vector<SceneQueryBatch*> query_batches;
+		//rigid actors of the last AddBatch, kept so batch insertion does not allocate
+		std::vector<PxActor*> batch_actors;
+		//the same actors as the input of a pruning structure
+		std::vector<PxRigidActor*> batch_rigid_actors;
+		//state after CustomInit: the first initial_actors actors and their dynamic state
+		SceneState initial_state;
+		PxU32 initial_actors;
+		//the initial state is still complete (no initial actor was removed)
+		bool initial_valid;
+		//restore the initial state on Reset instead of rebuilding the scene
+		bool fast_reset;
+		//objects deserialized by Load and the mapped file holding them
+		PxCollection* collection;
+		SceneFile* scene_file;
+		std::string scene_filename;
+		//air forces on the balls, applied before every simulate
+		Aerodynamics aerodynamics;
+		//collision rules between filter groups, the constant block of the filter shader
+		FilterTable filter_table;
+		//broadphase of new scenes, MBP regions form a subdivisions x subdivisions grid over WorldBounds
+		PxBroadPhaseType::Enum broadphase_type;
+		PxU32 broadphase_subdivisions;
+		BroadPhaseMonitor broadphase_monitor;
+		//continuous collision detection of new scenes and the bodies switched by the adaptive mode
+		CCDMode::Enum ccd_mode;
+		AdaptiveCCD ccd;
+		//force held on the selected actor, applied before every simulate
+		PxVec3 selected_force;
 
 		void HighlightOn(PxRigidDynamic* actor);
 
 		void HighlightOff(PxRigidDynamic* actor);
 
+		//take an actor out of the actor list, fixing the initial state and the selection
+		void Unlink(Actor* actor, const char* caller);
+
+		//delete the wrapper and release the PhysX actor
+		void DeleteActor(Actor* actor);
+
+		//per simulate forces and flags: air forces, adaptive CCD and the held force
+		void PreSimulate(PxReal sub_dt);
+
+		//delete all actors
+		void DeleteActors();
+
+		//create the PhysX scene
+		void CreateScene();
+
+		//cover WorldBounds with MBP regions
+		void CreateBroadPhaseRegions();
+
+		//set up CCD of a new dynamic actor according to the CCD mode
+		void RegisterCCD(Actor* actor);
+
+		//capture the initial state and prepare the first step
+		void InitState();
+
 	public:
+		///Constructor
+		///worker_count=-1 uses all hardware threads but one (left for rendering),
+		///the PHYSX_WORKER_COUNT environment variable overrides both
+		Scene(PxU32 worker_count=-1);
+
+		///Destructor
+		virtual ~Scene();
+
 		///Init the scene
 		void Init();
 
 		///User defined initialisation
 		virtual void CustomInit() {}
 
+		///Init the scene from a file written by Save, CustomLoad is called instead of CustomInit
+		void Load(const std::string& filename);
+
+		///User defined setup of a loaded scene: everything not stored in the file
+		///(callbacks, visualisation, pointers to actors, see Find)
+		virtual void CustomLoad() {}
+
+		///Write all actors, shapes, meshes and joints to a binary file.
+		///Materials are referenced by their index in the material registry, cloths are not stored
+		///(they are cheap to create from the fabric pool, e.g. in CustomLoad).
+		void Save(const std::string& filename);
+
 		///Perform a single simulation step
 		void Update(PxReal dt);
 
+		///Start a simulation step on the worker threads and return immediately
+		void BeginStep(PxReal dt);
+
+		///Wait for the running step (if any) and capture a new pose snapshot.
+		///Call it before modifying the scene while a step may be running.
+		void EndStep();
+
+		///Render state captured by the last EndStep
+		const PoseSnapshot& Snapshot();
+
+		///Render state captured one step before Snapshot()
+		const PoseSnapshot& PreviousSnapshot();
+
+		///Set the fixed time step, each step is split into substeps simulate calls.
+		///At most max_steps are taken per frame, the rest of a long frame is dropped.
+		void SetTimeStep(PxReal step, PxU32 substeps=1, PxU32 max_steps=4);
+
+		///Get the number of substeps
+		PxU32 Substeps();
+
+		///Consume real time in fixed steps, the last one is left running (see BeginStep).
+		///Returns the number of steps taken.
+		PxU32 Advance(PxReal frame_time);
+
+		///Fraction of a step left in the accumulator, used to blend the last two snapshots
+		PxReal Alpha();
+
 		///User defined update step
 		virtual void CustomUpdate() {}
 
-		///Add actors
-		void Add(Actor* actor);
+		///User defined reset, called before the actors spawned after CustomInit are deleted
+		virtual void CustomReset() {}
+
+		///Add actors, the scene takes ownership of the actor.
+		///With an aggregate (already added to the scene) the actor joins the aggregate.
+		void Add(Actor* actor, Aggregate* aggregate=0);
+
+		///Add an empty aggregate, the scene takes ownership of it
+		void Add(Aggregate* aggregate);
+
+		///Add a query batch created for this scene, the scene takes ownership of it.
+		///It is deleted by a full Reset, create it again in CustomInit.
+		void Add(SceneQueryBatch* batch);
+
+		///Add many actors with a single broadphase update, the scene takes ownership of the actors.
+		///pruning_structure prebuilds the scene query trees of the batch (best for static actors, SDK 3.4).
+		void AddBatch(const std::vector<Actor*>& batch, bool pruning_structure=false);
+
+		///Remove an actor from the scene, release it and delete it
+		void Remove(Actor* actor);
+
+		///Remove an actor from the scene without deleting it, the caller owns it again
+		///and can add it back later (see ActorPool). Loaded actors cannot be detached.
+		void Detach(Actor* actor);
+
+		///Get the first actor with the given name, 0 if there is none
+		Actor* Find(const std::string& name);
 
 		///Get the PxScene object
 		PxScene* Get();
 
-		///Reset the scene
+		///Balls affected by air forces, released actors are removed automatically
+		Aerodynamics& GetAerodynamics();
+
+		///Set the collision rules between filter groups, used by new scenes and applied to a running one at once
+		void SetFilterTable(const FilterTable& table);
+
+		///Get the collision rules between filter groups
+		const FilterTable& GetFilterTable();
+
+		///Reset the scene: restore the state after CustomInit (fast reset) or rebuild it
 		void Reset();
 
+		///Set fast reset, the scene is still rebuilt if an initial actor was removed
+		void FastReset(bool value);
+
+		///Get fast reset
+		bool FastReset();
+
+		///Set the broadphase used by the next Init, Load or full Reset.
+		///MBP splits WorldBounds into a grid of subdivisions x subdivisions regions.
+		void BroadPhase(PxBroadPhaseType::Enum type, PxU32 subdivisions=4);
+
+		///Get the broadphase type
+		PxBroadPhaseType::Enum BroadPhase();
+
+		///Area covered by the MBP regions, by default the static actors (planes excluded) plus a margin,
+		///unbounded in height. Objects leaving it stop colliding (see OutOfBounds).
+		virtual PxBounds3 WorldBounds();
+
+		///Number of objects that left the MBP regions
+		PxU32 OutOfBounds();
+
+		///Set continuous collision detection for the next Init, Load or full Reset
+		void ContinuousCollision(CCDMode::Enum mode);
+
+		///Get the CCD mode
+		CCDMode::Enum ContinuousCollision();
+
+		///Bodies switched by the adaptive CCD mode
+		AdaptiveCCD& GetCCD();
+
 		///Set pause
 		void Pause(bool value);
 
 		///Get pause
 		bool Pause();
 
+		///Get the number of simulation worker threads
+		PxU32 WorkerCount();
+
+		///Get the worker pool, it can also run non-PhysX jobs
+		TaskScheduler* GetScheduler();
+
 		///Get the selected dynamic actor on the scene
 		PxRigidDynamic* GetSelectedActor();
 
 		///Switch to the next dynamic actor
 		void SelectNextActor();
 
+		///Hold a force on the selected actor, it acts in every simulate until it is changed,
+		///so the impulse depends on the simulated time and not on the frame rate
+		void SelectedForce(const PxVec3& force);
+
+		///Get the force held on the selected actor
+		const PxVec3& SelectedForce();
+
 		///a list with all actors
 		std::vector<PxActor*> GetAllActors();
 	};
 
+	///Recycles spawned dynamic actors of one type: Release takes an actor out of the scene and keeps it,
+	///Spawn puts it back at rest at a new pose, so spawning and despawning do not allocate once the pool is warm.
+	///T is constructed with the pose as its first argument. Parked actors are deleted with the pool,
+	///a recycled ball has to be added to the scene aerodynamics again.
+	template<class T>
+	class ActorPool
+	{
+		Scene* scene;
+		//actors out of the scene, ready for reuse
+		std::vector<T*> free_actors;
+
+	public:
+		ActorPool(Scene* _scene, PxU32 capacity=128) : scene(_scene)
+		{
+			free_actors.reserve(capacity);
+		}
+
+		~ActorPool()
+		{
+			for (PxU32 i = 0; i < free_actors.size(); i++)
+			{
+				PxActor* actor = free_actors[i]->Get();
+				delete free_actors[i];
+				actor->release();
+			}
+		}
+
+		///Get an actor at rest at the pose in a filter group (see FilterTable), not added to the scene yet.
+		///Use it for batch insertion, Spawn adds a single actor.
+		T* Get(const PxTransform& pose, PxU32 filter_group=0)
+		{
+			T* actor;
+			if (free_actors.empty())
+				actor = new T(pose);
+			else
+			{
+				actor = free_actors.back();
+				free_actors.pop_back();
+				PxRigidDynamic* body = (PxRigidDynamic*)actor->Get();
+				body->setGlobalPose(pose);
+				body->setLinearVelocity(PxVec3(0));
+				body->setAngularVelocity(PxVec3(0));
+			}
+
+			//before the actor is added, so its pairs are filtered only once
+			actor->SetupFiltering(filter_group);
+			return actor;
+		}
+
+		///Get an actor in a filter group and add it to the scene
+		T* Spawn(const PxTransform& pose, PxU32 filter_group=0)
+		{
+			T* actor = Get(pose, filter_group);
+			scene->Add(actor);
+			((PxRigidDynamic*)actor->Get())->wakeUp();
+			return actor;
+		}
+
+		///Take an actor out of the scene and keep it for reuse
+		void Release(T* actor)
+		{
+			scene->Detach(actor);
+			free_actors.push_back(actor);
+		}
+
+		///Number of parked actors
+		PxU32 Size() const { return (PxU32)free_actors.size(); }
+	};
+
 	///Generic Joint class
 	class Joint
 	{
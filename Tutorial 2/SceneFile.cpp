@@ -0,0 +1,104 @@
+#include "SceneFile.h"
+#include "Exception.h"
+#include <Windows.h>
+#include <stdio.h>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	static const char scene_magic[4] = { 'R', 'S', 'C', 'N' };
+
+	SceneFile::SceneFile(const std::string& filename)
+		: file(INVALID_HANDLE_VALUE), mapping(0), view(0)
+	{
+		file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (file == INVALID_HANDLE_VALUE)
+			throw new Exception("PhysicsEngine::SceneFile::SceneFile, Could not open " + filename + ".");
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || (size.QuadPart < (LONGLONG)sizeof(Header)))
+		{
+			CloseHandle(file);
+			throw new Exception("PhysicsEngine::SceneFile::SceneFile, " + filename + " is not a scene file.");
+		}
+
+		//copy-on-write: PhysX patches pointers in place, the file itself is never modified
+		mapping = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+		if (mapping)
+			view = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+
+		const Header* header = (const Header*)view;
+		if (!view || memcmp(header->magic, scene_magic, sizeof(scene_magic)) || (header->version != version) ||
+			(header->collection_offset + header->collection_size > (PxU64)size.QuadPart) ||
+			(header->shapes_offset + header->nb_shapes * sizeof(ShapeEntry) > (PxU64)size.QuadPart))
+		{
+			if (view)
+				UnmapViewOfFile(view);
+			if (mapping)
+				CloseHandle(mapping);
+			CloseHandle(file);
+			throw new Exception("PhysicsEngine::SceneFile::SceneFile, " + filename + " is not a valid scene file.");
+		}
+	}
+
+	SceneFile::~SceneFile()
+	{
+		UnmapViewOfFile(view);
+		CloseHandle(mapping);
+		CloseHandle(file);
+	}
+
+	void SceneFile::Write(const std::string& filename, PxU32 nb_actors, const void* collection, PxU32 collection_size,
+		const ShapeEntry* shapes, PxU32 nb_shapes)
+	{
+		Header header;
+		memcpy(header.magic, scene_magic, sizeof(scene_magic));
+		header.version = version;
+		header.nb_actors = nb_actors;
+		header.nb_shapes = nb_shapes;
+		header.collection_offset = (sizeof(Header) + PX_SERIAL_FILE_ALIGN - 1) & ~(PxU64)(PX_SERIAL_FILE_ALIGN - 1);
+		header.collection_size = collection_size;
+		header.shapes_offset = header.collection_offset + collection_size;
+
+		FILE* out = 0;
+		if (fopen_s(&out, filename.c_str(), "wb") || !out)
+			throw new Exception("PhysicsEngine::SceneFile::Write, Could not create " + filename + ".");
+
+		std::vector<char> padding((size_t)(header.collection_offset - sizeof(Header)), 0);
+		bool ok = (fwrite(&header, sizeof(Header), 1, out) == 1);
+		if (ok && padding.size())
+			ok = (fwrite(padding.data(), padding.size(), 1, out) == 1);
+		if (ok && collection_size)
+			ok = (fwrite(collection, collection_size, 1, out) == 1);
+		if (ok && nb_shapes)
+			ok = (fwrite(shapes, sizeof(ShapeEntry), nb_shapes, out) == nb_shapes);
+		fclose(out);
+
+		if (!ok)
+			throw new Exception("PhysicsEngine::SceneFile::Write, Could not write " + filename + ".");
+	}
+
+	bool SceneFile::Exists(const std::string& filename)
+	{
+		FILE* in = 0;
+		if (fopen_s(&in, filename.c_str(), "rb") || !in)
+			return false;
+		fclose(in);
+		return true;
+	}
+
+	const SceneFile::Header& SceneFile::GetHeader() const
+	{
+		return *(const Header*)view;
+	}
+
+	void* SceneFile::Collection()
+	{
+		return view + GetHeader().collection_offset;
+	}
+
+	const SceneFile::ShapeEntry* SceneFile::Shapes() const
+	{
+		return (const ShapeEntry*)(view + GetHeader().shapes_offset);
+	}
+}
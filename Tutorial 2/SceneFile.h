@@ -0,0 +1,66 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Binary scene file written by Scene::Save: a header, the PhysX binary collection
+	///and the render attributes of the shapes.
+	///Opening the file maps it copy-on-write so that PhysX can deserialize the collection in place,
+	///the mapping has to stay open until all objects of the collection are released.
+	class SceneFile
+	{
+	public:
+		///File layout, offsets from the start of the file
+		struct Header
+		{
+			char magic[4];
+			PxU32 version;
+			//scene actors, serial ids 1..nb_actors in the order they were added
+			PxU32 nb_actors;
+			PxU32 nb_shapes;
+			PxU64 collection_offset;
+			PxU64 collection_size;
+			PxU64 shapes_offset;
+		};
+
+		///Render attributes of an exclusive shape, or of the shared shapes of an actor (see ShapeArena)
+		struct ShapeEntry
+		{
+			PxSerialObjectId id;
+			PxVec3 color;
+			PxU32 flags;
+		};
+
+		static const PxU32 version = 1;
+
+	private:
+		void* file;
+		void* mapping;
+		char* view;
+
+	public:
+		///Map an existing file
+		SceneFile(const std::string& filename);
+
+		///Unmap the file
+		~SceneFile();
+
+		///Write a new file, the collection is stored at a PX_SERIAL_FILE_ALIGN aligned offset
+		static void Write(const std::string& filename, PxU32 nb_actors, const void* collection, PxU32 collection_size,
+			const ShapeEntry* shapes, PxU32 nb_shapes);
+
+		///Check if the file can be opened
+		static bool Exists(const std::string& filename);
+
+		const Header& GetHeader() const;
+
+		///Serialized collection, aligned and writable
+		void* Collection();
+
+		const ShapeEntry* Shapes() const;
+	};
+}
@@ -0,0 +1,124 @@
+#include "SceneQueryBatch.h"
+#include "Exception.h"
+
+namespace PhysicsEngine
+{
+	static void Resize(std::vector<PxReal>* const* streams, PxU32 count, PxU32 size)
+	{
+		for (PxU32 i = 0; i < count; i++)
+			streams[i]->resize(size);
+	}
+
+	SceneQueryBatch::SceneQueryBatch(PxScene* scene, PxU32 _max_rays, PxU32 _max_sweeps, PxU32 _max_overlaps)
+		: filter(PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC), max_rays(_max_rays), max_sweeps(_max_sweeps), max_overlaps(_max_overlaps)
+	{
+		rays.count = sweeps.count = overlaps.count = 0;
+		std::vector<PxReal>* ray_streams[] = { &rays.ox, &rays.oy, &rays.oz, &rays.dx, &rays.dy, &rays.dz, &rays.distance };
+		std::vector<PxReal>* sweep_streams[] = { &sweeps.ox, &sweeps.oy, &sweeps.oz, &sweeps.dx, &sweeps.dy, &sweeps.dz, &sweeps.distance, &sweeps.radius };
+		std::vector<PxReal>* overlap_streams[] = { &overlaps.cx, &overlaps.cy, &overlaps.cz, &overlaps.radius };
+		Resize(ray_streams, sizeof(ray_streams) / sizeof(ray_streams[0]), max_rays);
+		Resize(sweep_streams, sizeof(sweep_streams) / sizeof(sweep_streams[0]), max_sweeps);
+		Resize(overlap_streams, sizeof(overlap_streams) / sizeof(overlap_streams[0]), max_overlaps);
+		ray_results.resize(max_rays);
+		sweep_results.resize(max_sweeps);
+		overlap_results.resize(max_overlaps);
+
+		//blocking hits only, no touch buffers
+		PxBatchQueryDesc desc(max_rays, max_sweeps, max_overlaps);
+		desc.queryMemory.userRaycastResultBuffer = max_rays ? ray_results.data() : 0;
+		desc.queryMemory.userSweepResultBuffer = max_sweeps ? sweep_results.data() : 0;
+		desc.queryMemory.userOverlapResultBuffer = max_overlaps ? overlap_results.data() : 0;
+
+		query = scene->createBatchQuery(desc);
+		if (!query)
+			throw new Exception("PhysicsEngine::SceneQueryBatch::SceneQueryBatch, Could not create the batch query.");
+	}
+
+	SceneQueryBatch::~SceneQueryBatch()
+	{
+		query->release();
+	}
+
+	PxU32 SceneQueryBatch::AddRay(const PxVec3& origin, const PxVec3& unit_dir, PxReal distance)
+	{
+		if (rays.count == max_rays)
+			throw new Exception("PhysicsEngine::SceneQueryBatch::AddRay, The batch is full.");
+
+		PxU32 i = rays.count++;
+		rays.ox[i] = origin.x; rays.oy[i] = origin.y; rays.oz[i] = origin.z;
+		rays.dx[i] = unit_dir.x; rays.dy[i] = unit_dir.y; rays.dz[i] = unit_dir.z;
+		rays.distance[i] = distance;
+		return i;
+	}
+
+	PxU32 SceneQueryBatch::AddSweep(const PxVec3& origin, PxReal radius, const PxVec3& unit_dir, PxReal distance)
+	{
+		if (sweeps.count == max_sweeps)
+			throw new Exception("PhysicsEngine::SceneQueryBatch::AddSweep, The batch is full.");
+
+		PxU32 i = sweeps.count++;
+		sweeps.ox[i] = origin.x; sweeps.oy[i] = origin.y; sweeps.oz[i] = origin.z;
+		sweeps.dx[i] = unit_dir.x; sweeps.dy[i] = unit_dir.y; sweeps.dz[i] = unit_dir.z;
+		sweeps.distance[i] = distance;
+		sweeps.radius[i] = radius;
+		return i;
+	}
+
+	PxU32 SceneQueryBatch::AddOverlap(const PxVec3& center, PxReal radius)
+	{
+		if (overlaps.count == max_overlaps)
+			throw new Exception("PhysicsEngine::SceneQueryBatch::AddOverlap, The batch is full.");
+
+		PxU32 i = overlaps.count++;
+		overlaps.cx[i] = center.x; overlaps.cy[i] = center.y; overlaps.cz[i] = center.z;
+		overlaps.radius[i] = radius;
+		return i;
+	}
+
+	void SceneQueryBatch::Clear()
+	{
+		rays.count = sweeps.count = overlaps.count = 0;
+	}
+
+	void SceneQueryBatch::Filter(PxQueryFlags flags)
+	{
+		filter = PxQueryFilterData(flags);
+	}
+
+	void SceneQueryBatch::Execute()
+	{
+		if ((rays.count > max_rays) || (sweeps.count > max_sweeps) || (overlaps.count > max_overlaps))
+			throw new Exception("PhysicsEngine::SceneQueryBatch::Execute, More queries than the batch was created for.");
+
+		for (PxU32 i = 0; i < rays.count; i++)
+			query->raycast(PxVec3(rays.ox[i], rays.oy[i], rays.oz[i]), PxVec3(rays.dx[i], rays.dy[i], rays.dz[i]), rays.distance[i],
+				0, PxHitFlag::eDEFAULT, filter);
+
+		for (PxU32 i = 0; i < sweeps.count; i++)
+			query->sweep(PxSphereGeometry(sweeps.radius[i]), PxTransform(PxVec3(sweeps.ox[i], sweeps.oy[i], sweeps.oz[i])),
+				PxVec3(sweeps.dx[i], sweeps.dy[i], sweeps.dz[i]), sweeps.distance[i], 0, PxHitFlag::eDEFAULT, filter);
+
+		//overlaps have no closest hit, the first one found is reported as the blocking hit
+		PxQueryFilterData any_hit(filter.data, filter.flags | PxQueryFlag::eANY_HIT);
+		for (PxU32 i = 0; i < overlaps.count; i++)
+			query->overlap(PxSphereGeometry(overlaps.radius[i]), PxTransform(PxVec3(overlaps.cx[i], overlaps.cy[i], overlaps.cz[i])),
+				0, any_hit);
+
+		query->execute();
+	}
+
+	const PxRaycastHit* SceneQueryBatch::RayHit(PxU32 index) const
+	{
+		return ray_results[index].hasBlock ? &ray_results[index].block : 0;
+	}
+
+	const PxSweepHit* SceneQueryBatch::SweepHit(PxU32 index) const
+	{
+		return sweep_results[index].hasBlock ? &sweep_results[index].block : 0;
+	}
+
+	PxRigidActor* SceneQueryBatch::OverlapHit(PxU32 index) const
+	{
+		return overlap_results[index].hasBlock ? overlap_results[index].block.actor : 0;
+	}
+}
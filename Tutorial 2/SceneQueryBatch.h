@@ -0,0 +1,94 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Raycasts, sphere sweeps and sphere overlaps executed together through a PxBatchQuery.
+	///Queries are written into structure-of-arrays buffers (with the Add methods, or directly after setting count),
+	///Execute runs all of them and keeps the blocking (closest) hit of each query.
+	///The buffers are sized by the constructor, nothing is allocated per query or per Execute.
+	///Execute reads the scene, call it between steps (after Scene::EndStep).
+	class SceneQueryBatch
+	{
+	public:
+		///Rays: origin, unit direction and length
+		struct Rays
+		{
+			PxU32 count;
+			std::vector<PxReal> ox, oy, oz, dx, dy, dz, distance;
+		};
+
+		///Spheres swept from an origin along a unit direction
+		struct Sweeps
+		{
+			PxU32 count;
+			std::vector<PxReal> ox, oy, oz, dx, dy, dz, distance, radius;
+		};
+
+		///Spheres tested for overlap
+		struct Overlaps
+		{
+			PxU32 count;
+			std::vector<PxReal> cx, cy, cz, radius;
+		};
+
+	private:
+		PxBatchQuery* query;
+		PxQueryFilterData filter;
+
+		Rays rays;
+		Sweeps sweeps;
+		Overlaps overlaps;
+		PxU32 max_rays, max_sweeps, max_overlaps;
+
+		std::vector<PxRaycastQueryResult> ray_results;
+		std::vector<PxSweepQueryResult> sweep_results;
+		std::vector<PxOverlapQueryResult> overlap_results;
+
+	public:
+		///Create the batch for a scene, it has to be released before the scene (see Scene::Add)
+		SceneQueryBatch(PxScene* scene, PxU32 max_rays, PxU32 max_sweeps=0, PxU32 max_overlaps=0);
+
+		~SceneQueryBatch();
+
+		///Ray buffers, fill the first count elements (count up to the max_rays of the constructor)
+		Rays& GetRays() { return rays; }
+
+		///Sweep buffers, fill the first count elements
+		Sweeps& GetSweeps() { return sweeps; }
+
+		///Overlap buffers, fill the first count elements
+		Overlaps& GetOverlaps() { return overlaps; }
+
+		///Append a ray and return its index
+		PxU32 AddRay(const PxVec3& origin, const PxVec3& unit_dir, PxReal distance);
+
+		///Append a sphere sweep and return its index
+		PxU32 AddSweep(const PxVec3& origin, PxReal radius, const PxVec3& unit_dir, PxReal distance);
+
+		///Append a sphere overlap and return its index
+		PxU32 AddOverlap(const PxVec3& center, PxReal radius);
+
+		///Remove all queries (results of the last Execute stay valid until the next one)
+		void Clear();
+
+		///Only test the given actor kinds (PxQueryFlag::eSTATIC, eDYNAMIC), both by default
+		void Filter(PxQueryFlags flags);
+
+		///Run all queries
+		void Execute();
+
+		///Closest hit of a ray in the last Execute, 0 if it hit nothing
+		const PxRaycastHit* RayHit(PxU32 index) const;
+
+		///Closest hit of a sweep in the last Execute, 0 if it hit nothing
+		const PxSweepHit* SweepHit(PxU32 index) const;
+
+		///An actor overlapping a sphere in the last Execute, 0 if there is none
+		PxRigidActor* OverlapHit(PxU32 index) const;
+	};
+}
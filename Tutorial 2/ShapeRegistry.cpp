@@ -0,0 +1,104 @@
+#include "ShapeRegistry.h"
+#include "PhysicsEngine.h"
+
+namespace PhysicsEngine
+{
+	//append the bytes of a single field, fields are appended one by one to leave out struct padding
+	template<class T>
+	static void Append(std::string& key, const T& value)
+	{
+		key.append((const char*)&value, sizeof(T));
+	}
+
+	static void Append(std::string& key, const PxMeshScale& scale)
+	{
+		Append(key, scale.scale);
+		Append(key, scale.rotation);
+	}
+
+	static std::string Key(const PxGeometry& geometry, PxMaterial* material, const PxTransform& local_pose, PxShapeFlags flags,
+		const PxFilterData& filter_data)
+	{
+		std::string key;
+		PxGeometryHolder holder(geometry);
+		Append(key, (PxU32)geometry.getType());
+
+		switch (geometry.getType())
+		{
+		case PxGeometryType::eSPHERE:
+			Append(key, holder.sphere().radius);
+			break;
+		case PxGeometryType::ePLANE:
+			break;
+		case PxGeometryType::eCAPSULE:
+			Append(key, holder.capsule().radius);
+			Append(key, holder.capsule().halfHeight);
+			break;
+		case PxGeometryType::eBOX:
+			Append(key, holder.box().halfExtents);
+			break;
+		case PxGeometryType::eCONVEXMESH:
+			Append(key, holder.convexMesh().convexMesh);
+			Append(key, holder.convexMesh().scale);
+#if PX_PHYSICS_VERSION >= 0x304000 // SDK 3.4
+			Append(key, (PxU32)holder.convexMesh().meshFlags);
+#endif
+			break;
+		case PxGeometryType::eTRIANGLEMESH:
+			Append(key, holder.triangleMesh().triangleMesh);
+			Append(key, holder.triangleMesh().scale);
+			Append(key, (PxU32)holder.triangleMesh().meshFlags);
+			break;
+		case PxGeometryType::eHEIGHTFIELD:
+			Append(key, holder.heightField().heightField);
+			Append(key, holder.heightField().heightScale);
+			Append(key, holder.heightField().rowScale);
+			Append(key, holder.heightField().columnScale);
+			Append(key, (PxU32)holder.heightField().heightFieldFlags);
+			break;
+		default:
+			throw new Exception("PhysicsEngine::ShapeRegistry::Get, Unsupported geometry type.");
+		}
+
+		Append(key, material);
+		Append(key, (PxU8)flags);
+		Append(key, local_pose.p);
+		Append(key, local_pose.q);
+		Append(key, filter_data.word0);
+		Append(key, filter_data.word1);
+		Append(key, filter_data.word2);
+		Append(key, filter_data.word3);
+		return key;
+	}
+
+	PxShape* ShapeRegistry::Get(const PxGeometry& geometry, PxMaterial* material, const PxTransform& local_pose, PxShapeFlags flags,
+		const PxFilterData& filter_data)
+	{
+		std::string key = Key(geometry, material, local_pose, flags, filter_data);
+		std::unordered_map<std::string, PxShape*>::iterator it = shapes.find(key);
+		if (it != shapes.end())
+			return it->second;
+
+		PxShape* shape = GetPhysics()->createShape(geometry, *material, false, flags);
+		if (!shape)
+			throw new Exception("PhysicsEngine::ShapeRegistry::Get, Could not create the shape.");
+		shape->setLocalPose(local_pose);
+		shape->setSimulationFilterData(filter_data);
+
+		shapes[key] = shape;
+		return shape;
+	}
+
+	void ShapeRegistry::Clear()
+	{
+		for (std::unordered_map<std::string, PxShape*>::iterator it = shapes.begin(); it != shapes.end(); it++)
+			it->second->release();
+		shapes.clear();
+	}
+
+	ShapeRegistry& GetShapeRegistry()
+	{
+		static ShapeRegistry registry;
+		return registry;
+	}
+}
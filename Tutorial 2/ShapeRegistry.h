@@ -0,0 +1,35 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+#include <unordered_map>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Shared (non-exclusive) shapes: each distinct (geometry, material, flags, local pose, filter data) is created once
+	///and attached to all actors using it. The registry keeps one PhysX reference per shape, the shape is
+	///destroyed once it is cleared from the registry and detached from the last actor.
+	///Shared shapes have no render attributes of their own, they are drawn with the id of the actor (see SetActorId).
+	class ShapeRegistry
+	{
+		//raw bytes of the key fields
+		std::unordered_map<std::string, PxShape*> shapes;
+
+	public:
+		///Get the shared shape, created on first use
+		PxShape* Get(const PxGeometry& geometry, PxMaterial* material, const PxTransform& local_pose=PxTransform(PxIdentity),
+			PxShapeFlags flags=PxShapeFlag::eVISUALIZATION | PxShapeFlag::eSCENE_QUERY_SHAPE | PxShapeFlag::eSIMULATION_SHAPE,
+			const PxFilterData& filter_data=PxFilterData());
+
+		///Release the registry references of all shapes (actors keep theirs)
+		void Clear();
+
+		///Number of distinct shapes
+		PxU32 Size() const { return (PxU32)shapes.size(); }
+	};
+
+	///The registry used by DynamicActor::CreateSharedShape and StaticActor::CreateSharedShape
+	ShapeRegistry& GetShapeRegistry();
+}
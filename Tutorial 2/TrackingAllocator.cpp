@@ -0,0 +1,190 @@
+#include "TrackingAllocator.h"
+#include <algorithm>
+#include <iomanip>
+#include <malloc.h>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	TrackingAllocator::TrackingAllocator()
+		: total("total")
+	{
+		named.reserve(256);
+	}
+
+	TrackingAllocator::~TrackingAllocator()
+	{
+		for (PxU32 i = 0; i < chunks.size(); i++)
+			_aligned_free(chunks[i]);
+	}
+
+	PxU32 TrackingAllocator::SizeClass(size_t size)
+	{
+		//16, 32, ..., 2048 bytes
+		size_t block = min_block;
+		for (PxU32 i = 0; i < nb_classes; i++, block <<= 1)
+		{
+			if (size <= block)
+				return i;
+		}
+		return heap_class;
+	}
+
+	void* TrackingAllocator::AllocateBlock(PxU32 size_class)
+	{
+		Pool& pool = pools[size_class];
+		size_t block_size = sizeof(Header) + (min_block << size_class);
+
+		lock_guard<mutex> lock(pool.mutex);
+
+		//refill the free list from a new chunk
+		if (!pool.free_list)
+		{
+			char* chunk = (char*)_aligned_malloc(chunk_size, 16);
+			if (!chunk)
+				return 0;
+			{
+				lock_guard<mutex> chunk_lock(chunk_mutex);
+				chunks.push_back(chunk);
+			}
+			for (size_t offset = 0; offset + block_size <= chunk_size; offset += block_size)
+			{
+				*(void**)(chunk + offset) = pool.free_list;
+				pool.free_list = chunk + offset;
+			}
+		}
+
+		void* block = pool.free_list;
+		pool.free_list = *(void**)block;
+		return block;
+	}
+
+	PxU32 TrackingAllocator::NameIndex(const char* name)
+	{
+		//PhysX passes string literals, the pointer is a good enough key
+		map<const char*, PxU32>::iterator it = name_index.find(name);
+		if (it != name_index.end())
+			return it->second;
+
+		PxU32 index = (PxU32)named.size();
+		named.push_back(AllocationStats(name ? name : "<unnamed>"));
+		name_index[name] = index;
+		return index;
+	}
+
+	void* TrackingAllocator::allocate(size_t size, const char* typeName, const char* filename, int line)
+	{
+		PxU32 size_class = SizeClass(size);
+
+		Header* header;
+		if (size_class == heap_class)
+			header = (Header*)_aligned_malloc(sizeof(Header) + size, 16);
+		else
+			header = (Header*)AllocateBlock(size_class);
+
+		if (!header)
+			return 0;
+
+		header->size_class = size_class;
+		header->size = size;
+
+		{
+			lock_guard<mutex> lock(stats_mutex);
+			header->name_index = NameIndex(typeName);
+
+			AllocationStats* stats[2] = { &total, &named[header->name_index] };
+			for (PxU32 i = 0; i < 2; i++)
+			{
+				stats[i]->current_bytes += size;
+				stats[i]->peak_bytes = max(stats[i]->peak_bytes, stats[i]->current_bytes);
+				stats[i]->current_allocations++;
+				stats[i]->total_allocations++;
+			}
+		}
+
+		return header + 1;
+	}
+
+	void TrackingAllocator::deallocate(void* ptr)
+	{
+		if (!ptr)
+			return;
+
+		Header* header = (Header*)ptr - 1;
+
+		{
+			lock_guard<mutex> lock(stats_mutex);
+			AllocationStats* stats[2] = { &total, &named[header->name_index] };
+			for (PxU32 i = 0; i < 2; i++)
+			{
+				stats[i]->current_bytes -= (size_t)header->size;
+				stats[i]->current_allocations--;
+			}
+		}
+
+		if (header->size_class == heap_class)
+		{
+			_aligned_free(header);
+			return;
+		}
+
+		//back to the free list of its class
+		Pool& pool = pools[header->size_class];
+		lock_guard<mutex> lock(pool.mutex);
+		*(void**)header = pool.free_list;
+		pool.free_list = header;
+	}
+
+	AllocationStats TrackingAllocator::GetStats()
+	{
+		lock_guard<mutex> lock(stats_mutex);
+		return total;
+	}
+
+	vector<AllocationStats> TrackingAllocator::GetNamedStats()
+	{
+		vector<AllocationStats> result;
+		{
+			lock_guard<mutex> lock(stats_mutex);
+
+			//the same name can come from different string literals, merge them
+			map<string, PxU32> merged;
+			for (PxU32 i = 0; i < named.size(); i++)
+			{
+				map<string, PxU32>::iterator it = merged.find(named[i].name);
+				if (it == merged.end())
+				{
+					merged[named[i].name] = (PxU32)result.size();
+					result.push_back(named[i]);
+				}
+				else
+				{
+					AllocationStats& stats = result[it->second];
+					stats.current_bytes += named[i].current_bytes;
+					stats.peak_bytes += named[i].peak_bytes;
+					stats.current_allocations += named[i].current_allocations;
+					stats.total_allocations += named[i].total_allocations;
+				}
+			}
+		}
+
+		sort(result.begin(), result.end(), [](const AllocationStats& a, const AllocationStats& b) { return a.peak_bytes > b.peak_bytes; });
+		return result;
+	}
+
+	void TrackingAllocator::Dump(ostream& out, PxU32 max_names)
+	{
+		AllocationStats stats = GetStats();
+		vector<AllocationStats> names = GetNamedStats();
+
+		out << "PhysX memory: current " << stats.current_bytes << " bytes in " << stats.current_allocations
+			<< " blocks, peak " << stats.peak_bytes << " bytes, " << stats.total_allocations << " allocations" << endl;
+		out << setw(14) << "current" << setw(14) << "peak" << setw(10) << "live" << setw(12) << "total" << "  name" << endl;
+		for (PxU32 i = 0; (i < names.size()) && (i < max_names); i++)
+		{
+			out << setw(14) << names[i].current_bytes << setw(14) << names[i].peak_bytes << setw(10) << names[i].current_allocations
+				<< setw(12) << names[i].total_allocations << "  " << names[i].name << endl;
+		}
+	}
+}
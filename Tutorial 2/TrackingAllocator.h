@@ -0,0 +1,88 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Memory usage counters
+	struct AllocationStats
+	{
+		std::string name;
+		size_t current_bytes;
+		size_t peak_bytes;
+		size_t current_allocations;
+		size_t total_allocations;
+
+		AllocationStats(const std::string& _name="")
+			: name(_name), current_bytes(0), peak_bytes(0), current_allocations(0), total_allocations(0) {}
+	};
+
+	///PhysX allocator with size-class pools and usage statistics.
+	///Small blocks come from per-size free lists carved out of large chunks, bigger ones go to the heap.
+	///Counters are kept in total and per allocation name (PhysX passes type names).
+	class TrackingAllocator : public PxAllocatorCallback
+	{
+		//16 byte header in front of every block, keeps the PhysX alignment
+		struct Header
+		{
+			PxU32 size_class;
+			PxU32 name_index;
+			PxU64 size;
+		};
+
+		//free list of a single size class
+		struct Pool
+		{
+			std::mutex mutex;
+			void* free_list;
+			Pool() : free_list(0) {}
+		};
+
+		static const PxU32 nb_classes = 8;
+		static const PxU32 min_block = 16;
+		static const PxU32 chunk_size = 64 * 1024;
+		static const PxU32 heap_class = nb_classes;
+
+		Pool pools[nb_classes];
+		std::vector<void*> chunks;
+		std::mutex chunk_mutex;
+
+		std::mutex stats_mutex;
+		AllocationStats total;
+		std::vector<AllocationStats> named;
+		std::map<const char*, PxU32> name_index;
+
+		static PxU32 SizeClass(size_t size);
+
+		void* AllocateBlock(PxU32 size_class);
+
+		PxU32 NameIndex(const char* name);
+
+	public:
+		TrackingAllocator();
+
+		~TrackingAllocator();
+
+		///PxAllocatorCallback
+		virtual void* allocate(size_t size, const char* typeName, const char* filename, int line);
+
+		///PxAllocatorCallback
+		virtual void deallocate(void* ptr);
+
+		///Totals over all allocations
+		AllocationStats GetStats();
+
+		///Counters per allocation name, sorted by peak usage
+		std::vector<AllocationStats> GetNamedStats();
+
+		///Print the totals and the per-name table
+		void Dump(std::ostream& out, PxU32 max_names=-1);
+	};
+}
@@ -0,0 +1,176 @@
+#include "TrajectoryPredictor.h"
+#include <xmmintrin.h>
+#include <emmintrin.h>
+
+namespace PhysicsEngine
+{
+	void TrajectoryPredictor::Batch::Resize(PxU32 new_size)
+	{
+		size = new_size;
+		PxU32 padded = (new_size + 3) & ~3u;
+
+		std::vector<PxReal>* streams[] = { &px, &py, &pz, &vx, &vy, &vz, &x, &y, &t };
+		for (PxU32 i = 0; i < sizeof(streams) / sizeof(streams[0]); i++)
+		{
+			streams[i]->resize(padded);
+			//padding lanes stand still on the ground
+			for (PxU32 j = new_size; j < padded; j++)
+				(*streams[i])[j] = 0.f;
+		}
+		outcome.resize(padded);
+	}
+
+	void TrajectoryPredictor::Batch::Set(PxU32 index, const PxVec3& position, const PxVec3& velocity)
+	{
+		px[index] = position.x; py[index] = position.y; pz[index] = position.z;
+		vx[index] = velocity.x; vy[index] = velocity.y; vz[index] = velocity.z;
+	}
+
+	//a where the mask is clear, b where it is set
+	static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b));
+	}
+
+	void TrajectoryPredictor::Evaluate(Batch& batch) const
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 line_z = _mm_set1_ps(goal.line_z);
+		const __m128 center_x = _mm_set1_ps(goal.center_x);
+		const __m128 inner_x = _mm_set1_ps(goal.inner_x);
+		const __m128 outer_x = _mm_set1_ps(goal.outer_x);
+		const __m128 crossbar_bottom = _mm_set1_ps(goal.crossbar_bottom);
+		const __m128 crossbar_top = _mm_set1_ps(goal.crossbar_top);
+		const __m128 post_top = _mm_set1_ps(goal.post_top);
+		const __m128 radius = _mm_set1_ps(parameters.ball_radius);
+		const __m128 gravity = _mm_set1_ps(parameters.gravity);
+		const __m128 max_time = _mm_set1_ps(parameters.max_time);
+		const __m128 sign_mask = _mm_set1_ps(-0.f);
+
+		for (PxU32 i = 0; i < batch.size; i += 4)
+		{
+			__m128 px = _mm_loadu_ps(&batch.px[i]), py = _mm_loadu_ps(&batch.py[i]), pz = _mm_loadu_ps(&batch.pz[i]);
+			__m128 vx = _mm_loadu_ps(&batch.vx[i]), vy = _mm_loadu_ps(&batch.vy[i]), vz = _mm_loadu_ps(&batch.vz[i]);
+			__m128 x, y, t, reached;
+
+			//only kicks from in front of the line towards it can cross it
+			__m128 towards = _mm_and_ps(_mm_cmplt_ps(vz, zero), _mm_cmpgt_ps(pz, line_z));
+
+			if (parameters.drag <= 0.f)
+			{
+				//ballistic: z is linear in t, solve for the crossing and evaluate x and y there
+				reached = towards;
+				t = _mm_div_ps(_mm_sub_ps(line_z, pz), _mm_min_ps(vz, _mm_set1_ps(-1e-6f)));
+				x = _mm_add_ps(px, _mm_mul_ps(vx, t));
+				y = _mm_sub_ps(_mm_add_ps(py, _mm_mul_ps(vy, t)), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(.5f), gravity), _mm_mul_ps(t, t)));
+				//y is concave in t, above the ground at both ends means above it all the way
+				reached = _mm_and_ps(reached, _mm_and_ps(_mm_cmple_ps(t, max_time), _mm_cmpge_ps(y, zero)));
+			}
+			else
+			{
+				//drag: semi-implicit Euler, the same steps as Arc, until every lane crossed the line or landed
+				const __m128 dt = _mm_set1_ps(parameters.time_step);
+				const __m128 drag = _mm_set1_ps(parameters.drag);
+				const __m128 gravity_dt = _mm_mul_ps(gravity, dt);
+				PxU32 steps = (PxU32)(parameters.max_time / parameters.time_step);
+
+				__m128 done = _mm_andnot_ps(towards, _mm_cmpeq_ps(zero, zero));
+				x = y = t = reached = zero;
+				if (_mm_movemask_ps(done) == 0xF)
+					steps = 0;
+				for (PxU32 n = 0; n < steps; n++)
+				{
+					__m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+					__m128 damping = _mm_mul_ps(_mm_mul_ps(drag, speed), dt);
+					vx = _mm_sub_ps(vx, _mm_mul_ps(damping, vx));
+					vy = _mm_sub_ps(_mm_sub_ps(vy, _mm_mul_ps(damping, vy)), gravity_dt);
+					vz = _mm_sub_ps(vz, _mm_mul_ps(damping, vz));
+
+					__m128 nx = _mm_add_ps(px, _mm_mul_ps(vx, dt));
+					__m128 ny = _mm_add_ps(py, _mm_mul_ps(vy, dt));
+					__m128 nz = _mm_add_ps(pz, _mm_mul_ps(vz, dt));
+
+					//interpolate the crossing within the step
+					__m128 crossed = _mm_andnot_ps(done, _mm_cmple_ps(nz, line_z));
+					__m128 f = _mm_div_ps(_mm_sub_ps(pz, line_z), _mm_max_ps(_mm_sub_ps(pz, nz), _mm_set1_ps(1e-6f)));
+					__m128 cy = _mm_add_ps(py, _mm_mul_ps(f, _mm_sub_ps(ny, py)));
+					crossed = _mm_and_ps(crossed, _mm_cmpge_ps(cy, zero));
+					x = Select(crossed, x, _mm_add_ps(px, _mm_mul_ps(f, _mm_sub_ps(nx, px))));
+					y = Select(crossed, y, cy);
+					t = Select(crossed, t, _mm_mul_ps(_mm_add_ps(_mm_set1_ps((PxReal)n), f), dt));
+					reached = _mm_or_ps(reached, crossed);
+
+					//lanes that landed first stay short
+					__m128 landed = _mm_cmplt_ps(ny, zero);
+					done = _mm_or_ps(done, _mm_or_ps(crossed, landed));
+					if (_mm_movemask_ps(done) == 0xF)
+						break;
+
+					px = nx; py = ny; pz = nz;
+				}
+			}
+
+			//distance of the ball centre from the middle of the posts, split into three bands:
+			//clear between the uprights, touching an upright and clear outside them
+			__m128 dx = _mm_andnot_ps(sign_mask, _mm_sub_ps(x, center_x));
+			__m128 between = _mm_cmple_ps(_mm_add_ps(dx, radius), inner_x);
+			__m128 outside = _mm_cmpge_ps(_mm_sub_ps(dx, radius), outer_x);
+			__m128 upright = _mm_andnot_ps(_mm_or_ps(between, outside), reached);
+
+			__m128 over_crossbar = _mm_cmpge_ps(_mm_sub_ps(y, radius), crossbar_top);
+			__m128 on_crossbar = _mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(y, radius), crossbar_bottom), _mm_cmplt_ps(_mm_sub_ps(y, radius), crossbar_top));
+			__m128 below_post_top = _mm_cmplt_ps(_mm_sub_ps(y, radius), post_top);
+			//over the top of an upright the centre decides, as if the upright went on
+			__m128 inside = _mm_cmplt_ps(dx, inner_x);
+
+			__m128 post = _mm_or_ps(_mm_and_ps(_mm_and_ps(reached, between), on_crossbar), _mm_and_ps(upright, below_post_top));
+			__m128 over_upright = _mm_andnot_ps(below_post_top, upright);
+			__m128 converted = _mm_or_ps(_mm_and_ps(_mm_and_ps(reached, between), over_crossbar), _mm_and_ps(over_upright, inside));
+			__m128 wide = _mm_or_ps(_mm_and_ps(reached, outside), _mm_andnot_ps(inside, over_upright));
+
+			//everything else (landed, under the bar, too slow) is short
+			__m128 result = _mm_set1_ps((PxReal)SHORT);
+			result = Select(wide, result, _mm_set1_ps((PxReal)WIDE));
+			result = Select(post, result, _mm_set1_ps((PxReal)POST));
+			result = Select(converted, result, _mm_set1_ps((PxReal)GOAL));
+
+			_mm_storeu_ps(&batch.x[i], x); _mm_storeu_ps(&batch.y[i], y); _mm_storeu_ps(&batch.t[i], t);
+			_mm_storeu_si128((__m128i*)&batch.outcome[i], _mm_cvttps_epi32(result));
+		}
+	}
+
+	PxU32 TrajectoryPredictor::Arc(const PxVec3& position, const PxVec3& velocity, PxVec3* points, PxU32 max_points) const
+	{
+		//a kick that cannot cross the line has no arc to the goal, as in Evaluate
+		if (!max_points || (velocity.z >= 0.f) || (position.z <= goal.line_z))
+			return 0;
+
+		PxReal dt = parameters.time_step;
+		PxVec3 gravity(0.f, -parameters.gravity, 0.f);
+		PxVec3 p = position, v = velocity;
+		PxU32 steps = (PxU32)(parameters.max_time / dt);
+
+		PxU32 count = 0;
+		points[count++] = p;
+		for (PxU32 n = 1; (n <= steps) && (count < max_points); n++)
+		{
+			if (parameters.drag <= 0.f)
+			{
+				//exact points, not accumulated
+				PxReal time = n * dt;
+				p = position + velocity * time + gravity * (.5f * time * time);
+			}
+			else
+			{
+				v += (gravity - v * (parameters.drag * v.magnitude())) * dt;
+				p += v * dt;
+			}
+			points[count++] = p;
+
+			//stop on the first point past the goal line or under the ground
+			if ((p.z <= goal.line_z) || (p.y < 0.f))
+				break;
+		}
+		return count;
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Predicts where kicks cross the goal line without running PhysX.
+	///Candidate kicks are evaluated 4 at a time with SSE: the ballistic flight is solved analytically,
+	///with drag (a = g - k|v|v) it is integrated in fixed steps. Bounces and spin are not modelled.
+	class TrajectoryPredictor
+	{
+	public:
+		enum Outcome { SHORT, WIDE, POST, GOAL };
+
+		///Goal posts in world space, kicks travel towards -z and cross the goal line z=line_z.
+		///The defaults are those of RugbyGoalPost.
+		struct Goal
+		{
+			PxReal line_z;
+			PxReal center_x;
+			//distance of the inner and outer faces of the uprights from the centre
+			PxReal inner_x;
+			PxReal outer_x;
+			PxReal crossbar_bottom;
+			PxReal crossbar_top;
+			PxReal post_top;
+
+			Goal() : line_z(-80.f), center_x(0.f), inner_x(5.1f), outer_x(6.1f), crossbar_bottom(5.7f), crossbar_top(6.3f), post_top(27.f) {}
+		};
+
+		struct Parameters
+		{
+			//downwards acceleration, m/s^2
+			PxReal gravity;
+			//k in a = g - k|v|v (1/m), 0 for a ballistic flight
+			PxReal drag;
+			//the ball has to clear the posts by this much
+			PxReal ball_radius;
+			//integration step with drag and spacing of the arc points
+			PxReal time_step;
+			//kicks not reaching the goal line by then fall short
+			PxReal max_time;
+
+			Parameters() : gravity(9.81f), drag(0.f), ball_radius(.2f), time_step(1.f/60.f), max_time(6.f) {}
+		};
+
+		///Kicks and results as structure of arrays, padded to a multiple of 4 elements
+		struct Batch
+		{
+			PxU32 size;
+			//launch position and velocity
+			std::vector<PxReal> px, py, pz, vx, vy, vz;
+			//crossing of the goal line: position, time and Outcome
+			std::vector<PxReal> x, y, t;
+			std::vector<PxI32> outcome;
+
+			Batch() : size(0) {}
+
+			///Set the number of kicks, the padding never reaches the goal
+			void Resize(PxU32 size);
+
+			///Set a kick
+			void Set(PxU32 index, const PxVec3& position, const PxVec3& velocity);
+		};
+
+	private:
+		Goal goal;
+		Parameters parameters;
+
+	public:
+		void SetGoal(const Goal& value) { goal = value; }
+
+		const Goal& GetGoal() const { return goal; }
+
+		void SetParameters(const Parameters& value) { parameters = value; }
+
+		const Parameters& GetParameters() const { return parameters; }
+
+		///Find the goal line crossing and the outcome of all kicks in a batch
+		void Evaluate(Batch& batch) const;
+
+		///Points of the flight of a single kick, time_step apart, until shortly after the goal line
+		///or the ground. Returns the number of points written, 0 for kicks that cannot cross the line.
+		PxU32 Arc(const PxVec3& position, const PxVec3& velocity, PxVec3* points, PxU32 max_points) const;
+	};
+}
@@ -1,21 +1,50 @@
 #include <iostream>
+#include <string>
 #include "VisualDebugger.h"
+#include "Benchmark.h"
 
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {
+	//headless benchmarks
+	if ((argc > 2) && (string(argv[1]) == "-bench"))
+	{
+		try
+		{
+			PhysicsEngine::PxInit();
+			if (!Benchmark::Run(argv[2], argc, argv))
+				Benchmark::Usage();
+			PhysicsEngine::PxRelease();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+		}
+		return 0;
+	}
+
+	//prebuilt scene: -scene <file>
+	const char* scene_file = 0;
+	if ((argc > 2) && (string(argv[1]) == "-scene"))
+		scene_file = argv[2];
+
 	try 
 	{ 
-		VisualDebugger::Init("Tutorial 2", 800, 800); 
+		VisualDebugger::Init("Tutorial 2", 800, 800, scene_file); 
 	}
 	catch (Exception exc) 
 	{ 
 		cerr << exc.what() << endl;
 		return 0; 
 	}
+	catch (Exception* exc)
+	{
+		cerr << exc->what() << endl;
+		return 0;
+	}
 
 	VisualDebugger::Start();
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -3,6 +3,7 @@
 #include "Extras\Camera.h"
 #include "Extras\Renderer.h"
 #include "Extras\HUD.h"
+#include <chrono>
 
 namespace VisualDebugger
 {
@@ -33,6 +34,7 @@ namespace VisualDebugger
 	void exitCallback(void);
 
 	void RenderScene();
+	void RenderKickPrediction();
 	void ToggleRenderMode();
 	void HUDInit();
 
@@ -40,6 +42,14 @@ namespace VisualDebugger
 	Camera* camera;
 	PhysicsEngine::MyScene* scene;
 	PxReal delta_time = 1.f/60.f;
+	//physics rate: fixed step and substeps (60 Hz x 4 = 240 Hz for fast kicks)
+	PxReal physics_step = 1.f/60.f;
+	PxU32 physics_substeps = 1;
+	//real time clock driving the simulation
+	std::chrono::high_resolution_clock::time_point last_frame;
+	bool clock_started = false;
+	//interpolated poses handed to the renderer
+	std::vector<PxTransform> render_poses;
 	PxReal gForceStrength = 20;
 	RenderMode render_mode = NORMAL;
 	const int MAX_KEYS = 256;
@@ -48,18 +58,29 @@ namespace VisualDebugger
 	HUD hud;
 
 	//Init the debugger
-	void Init(const char *window_name, int width, int height)
+	void Init(const char *window_name, int width, int height, const char* scene_file)
 	{
 		///Init PhysX
 		PhysicsEngine::PxInit();
 		scene = new PhysicsEngine::MyScene();
-		scene->Init();
+		if (scene_file && PhysicsEngine::SceneFile::Exists(scene_file))
+		{
+			scene->Load(scene_file);
+		}
+		else
+		{
+			scene->Init();
+			if (scene_file)
+				scene->Save(scene_file);
+		}
+		scene->SetTimeStep(physics_step, physics_substeps);
 
 		///Init renderer
 		Renderer::BackgroundColor(PxVec3(150.f/255.f,150.f/255.f,150.f/255.f));
 		Renderer::SetRenderDetail(40);
 		Renderer::InitWindow(window_name, width, height);
 		Renderer::Init();
+		Renderer::SetTaskScheduler(scene->GetScheduler());
 
 		camera = new Camera(PxVec3(0.0f, 5.0f, 15.0f), PxVec3(0.f,-.1f,-1.f), 5.f);
 
@@ -96,6 +117,8 @@ namespace VisualDebugger
 		hud.AddLine(HELP, "    F9 - select next actor");
 		hud.AddLine(HELP, "    F10 - pause");
 		hud.AddLine(HELP, "    F12 - reset");
+		hud.AddLine(HELP, "    T - physics rate 60/240 Hz");
+		hud.AddLine(HELP, "    E - contact log on/off");
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Display");
 		//hud.AddLine(HELP, "    F5 - help on/off");
@@ -114,6 +137,8 @@ namespace VisualDebugger
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Rugby Ball");
 		hud.AddLine(HELP, "    F1 - Spawn New Ball (Despawns old)");
+		hud.AddLine(HELP, "    O,P,Y,H,B,N - aim left,right,up,down,softer,harder");
+		hud.AddLine(HELP, "    F - kick");
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Bricks");
 		hud.AddLine(HELP, "    F11 - Spawn Brick For Free Kick");
@@ -153,26 +178,48 @@ namespace VisualDebugger
 	}
 
 	//Render the scene and perform a single simulation step
+	//the step runs on the worker threads while the previous one is drawn
 	void RenderScene()
 	{
+		//collect the step started in the previous frame
+		scene->EndStep();
+
 		//handle pressed keys
 		KeyHold();
 
+		//the kick prediction only reads the ball pose, no simulation
+		scene->PredictKick();
+
 		//start rendering
 		Renderer::Start(camera->getEye(), camera->getDir());
 
+		//the debug buffer is only valid between steps
 		if ((render_mode == DEBUG) || (render_mode == BOTH))
 		{
 			Renderer::Render(scene->Get()->getRenderBuffer());
 		}
 
+		//simulate the real time elapsed since the last frame in fixed steps
+		std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+		PxReal frame_time = clock_started ? std::chrono::duration<PxReal>(now - last_frame).count() : delta_time;
+		last_frame = now;
+		clock_started = true;
+
+		scene->Advance(frame_time);
+
 		if ((render_mode == NORMAL) || (render_mode == BOTH))
 		{
-			std::vector<PxActor*> actors = scene->GetAllActors();
-			if (actors.size())
-				Renderer::Render(&actors[0], (PxU32)actors.size());
+			//blend the last two steps at the time left in the accumulator
+			const PhysicsEngine::PoseSnapshot& snapshot = scene->Snapshot();
+			snapshot.Interpolate(scene->PreviousSnapshot(), scene->Alpha(), render_poses);
+			if (snapshot.actors.size())
+				Renderer::Render((PxActor**)&snapshot.actors[0], &render_poses[0], &snapshot.particle_offsets[0],
+					snapshot.particles.size() ? &snapshot.particles[0] : 0, (PxU32)snapshot.actors.size());
 		}
 
+		//predicted flight of the aimed kick
+		RenderKickPrediction();
+
 		//adjust the HUD state
 		if (hud_show)
 		{
@@ -189,9 +236,25 @@ namespace VisualDebugger
 
 		//finish rendering
 		Renderer::Finish();
+	}
+
+	//draw the predicted arc of the aimed kick, colored by its outcome, and the aim below the HUD
+	void RenderKickPrediction()
+	{
+		static const PxVec3 colors[] = { PxVec3(1.f, 0.f, 0.f), PxVec3(1.f, .5f, 0.f), PxVec3(1.f, 1.f, 0.f), PxVec3(0.f, 1.f, 0.f) };
+		static const char* names[] = { "short", "wide", "post", "goal" };
+
+		PhysicsEngine::TrajectoryPredictor::Outcome outcome = scene->KickOutcome();
+		Renderer::RenderLines(scene->KickArc(), scene->KickArcSize(), colors[outcome], 2.f);
 
-		//perform a single simulation step
-		scene->Update(delta_time);
+		if (!hud_show)
+			return;
+
+		PxVec3 aim = scene->KickAim();
+		char text[128];
+		sprintf_s(text, sizeof(text), "Kick: yaw %.0f, pitch %.0f, %.0f m/s - %s, %.0f%% of the spread converts",
+			aim.x, aim.y, aim.z, names[outcome], scene->KickChance() * 100.f);
+		Renderer::RenderText(text, PxVec2(0.f, .02f), PxVec3(0.f, 0.f, 0.f), .018f);
 	}
 
 	//user defined keyboard handlers
@@ -202,6 +265,38 @@ namespace VisualDebugger
 		//implement your own
 		case 'R':
 			break;
+		case 'T':
+			//toggle 240 Hz physics
+			physics_substeps = (physics_substeps == 1) ? 4 : 1;
+			scene->SetTimeStep(physics_step, physics_substeps);
+			break;
+		case 'E':
+			scene->LogEvents(!scene->LogEvents());
+			break;
+		//kick aim
+		case 'O':
+			scene->AimKick(-1.f, 0.f, 0.f);
+			break;
+		case 'P':
+			scene->AimKick(1.f, 0.f, 0.f);
+			break;
+		case 'Y':
+			scene->AimKick(0.f, 1.f, 0.f);
+			break;
+		case 'H':
+			scene->AimKick(0.f, -1.f, 0.f);
+			break;
+		case 'B':
+			scene->AimKick(0.f, 0.f, -1.f);
+			break;
+		case 'N':
+			scene->AimKick(0.f, 0.f, 1.f);
+			break;
+		case 'F':
+			//the ball is changed between steps
+			scene->EndStep();
+			scene->Kick();
+			break;
 		default:
 			break;
 		}
@@ -251,8 +346,8 @@ namespace VisualDebugger
 		}
 	}
 
-	//handle force control keys
-	void ForceInput(int key)
+	//handle force control keys, the force directions of the held keys are summed up
+	void ForceInput(int key, PxVec3& force)
 	{
 		if (!scene->GetSelectedActor())
 			return;
@@ -261,22 +356,22 @@ namespace VisualDebugger
 		{
 			// Force controls on the selected actor
 		case 'I': //forward
-			scene->GetSelectedActor()->addForce(PxVec3(0,0,-1)*gForceStrength);
+			force += PxVec3(0,0,-1);
 			break;
 		case 'K': //backward
-			scene->GetSelectedActor()->addForce(PxVec3(0,0,1)*gForceStrength);
+			force += PxVec3(0,0,1);
 			break;
 		case 'J': //left
-			scene->GetSelectedActor()->addForce(PxVec3(-1,0,0)*gForceStrength);
+			force += PxVec3(-1,0,0);
 			break;
 		case 'L': //right
-			scene->GetSelectedActor()->addForce(PxVec3(1,0,0)*gForceStrength);
+			force += PxVec3(1,0,0);
 			break;
 		case 'U': //up
-			scene->GetSelectedActor()->addForce(PxVec3(0,1,0)*gForceStrength);
+			force += PxVec3(0,1,0);
 			break;
 		case 'M': //down
-			scene->GetSelectedActor()->addForce(PxVec3(0,-1,0)*gForceStrength);
+			force += PxVec3(0,-1,0);
 			break;
 		case 'V': //down
 			scene->planeMatGlass();
@@ -296,6 +391,9 @@ namespace VisualDebugger
 	///handle special keys
 	void KeySpecial(int key, int x, int y)
 	{
+		//the actions below modify the scene, wait for the running step
+		scene->EndStep();
+
 		//simulation control
 		switch (key)
 		{
@@ -389,15 +487,19 @@ namespace VisualDebugger
 	//handle holded keys
 	void KeyHold()
 	{
+		PxVec3 force(0.f);
 		for (int i = 0; i < MAX_KEYS; i++)
 		{
 			if (key_state[i]) // if key down
 			{
 				CameraInput(i);
-				ForceInput(i);
+				ForceInput(i, force);
 				UserKeyHold(i);
 			}
 		}
+
+		//the scene applies the held force in every simulate of the coming steps
+		scene->SelectedForce(force*gForceStrength);
 	}
 
 	///mouse handling
@@ -7,7 +7,8 @@ namespace VisualDebugger
 	using namespace physx;
 
 	///Init visualisation
-	void Init(const char *window_name, int width=512, int height=512);
+	///scene_file: load the scene from this file, or build it and save it there if the file does not exist
+	void Init(const char *window_name, int width=512, int height=512, const char* scene_file=0);
 
 	///Start visualisation
 	void Start();